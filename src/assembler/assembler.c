@@ -5,6 +5,8 @@
 #include "assembler.h"
 #include "lexer.h"
 #include "../helper.h"
+#include "../minifloat.h"
+#include "../compress.h"
 
 //the largest positive and negative offset for 8-bit integer
 #define MAX_PC_REL_8_OFFSET_NEG 128
@@ -196,6 +198,9 @@ void ryvm_assembler_print(struct ryvm_assembler_state *asm_state) {
 
         default: assert(0);
       }
+      if(entry->d.ins.ext_size > 0) {
+        printf("(ext %lld) ", (long long) entry->d.ins.ext);
+      }
       printf("\n");
 
     } else {
@@ -364,9 +369,14 @@ int ryvm_assembler_parse_number_list(struct ryvm_assembler_state *asm_state, enu
       e.d.num = tok.d.num;
 
       //the lexer returns the float as a 64-bit value by default. 
-      //If we expect a single precision float, convert it to that type.
-      if(tok.tag == RYVM_TOKEN_FLOAT_LITERAL && bytewidth <= 4) {
+      //If we expect a smaller float, convert it to that type.
+      //2-byte floats are stored as f16, and 1-byte floats are stored as FP8 (see src/minifloat.h)
+      if(tok.tag == RYVM_TOKEN_FLOAT_LITERAL && bytewidth == 4) {
         e.d.num.f32 = (float) e.d.num.f64;
+      } else if(tok.tag == RYVM_TOKEN_FLOAT_LITERAL && bytewidth == 2) {
+        e.d.num.f16 = ryvm_minifloat_f32_to_f16((float) e.d.num.f64);
+      } else if(tok.tag == RYVM_TOKEN_FLOAT_LITERAL && bytewidth == 1) {
+        e.d.num.u8 = ryvm_minifloat_f32_to_fp8((float) e.d.num.f64);
       }
 
       e.using_placeholder = 0;
@@ -546,6 +556,81 @@ int ryvm_parse_data_entry(struct ryvm_assembler_state *asm_state, struct ryvm_to
 }
 
 
+//fills in the integer immediate of an instruction. Immediates that are too big for the
+//instruction are moved into an extension word, picking the shortest opcode that can hold them:
+//  LDI -> LDI32 -> LDI64
+//  ADDI, SUBI, XORI -> ADDI32, SUBI32, XORI32
+//Returns 0 if the value does not fit in any encoding.
+int ryvm_assembler_set_int_imm(struct ryvm_assembler_state *asm_state, struct ryvm_assembler_ins *ins, union num value) {
+  int64_t s = value.s64;
+  uint8_t fits8 = s >= INT8_MIN && s <= INT8_MAX;
+  uint8_t fits16 = s >= INT16_MIN && s <= INT16_MAX;
+  uint8_t fits32 = s >= INT32_MIN && s <= INT32_MAX;
+
+  //the bytewidth of the 1st register, the extra bytes of a wider immediate are thrown away anyway
+  uint8_t bytewidth = 1 << (ins->regs[0] >> 6);
+
+  ins->has_placeholder = 0;
+  ins->ext_size = 0;
+  ins->ext = value.u64;
+
+  switch((enum ryvm_opcode) ins->opcode) {
+    case RYVM_OP_LDI:
+      if(bytewidth <= 2 || fits16) {
+        memcpy(ins->regs + 1, &value.u16, 2);
+        return 1;
+      }
+      ins->opcode = bytewidth <= 4 || fits32 ? RYVM_OP_LDI32 : RYVM_OP_LDI64;
+      break;
+
+    case RYVM_OP_ADDI:
+    case RYVM_OP_SUBI:
+      if(fits8) {
+        ins->regs[2] = value.u8;
+        return 1;
+      }
+      ins->opcode = ins->opcode == RYVM_OP_ADDI ? RYVM_OP_ADDI32 : RYVM_OP_SUBI32;
+      break;
+
+    //XORI zero extends its 8-bit immediate, so a negative literal like -1 has always meant 0xFF
+    case RYVM_OP_XORI:
+      if(s >= INT8_MIN && s <= UINT8_MAX) {
+        ins->regs[2] = value.u8;
+        return 1;
+      }
+      ins->opcode = RYVM_OP_XORI32;
+      break;
+
+    default:
+      break;
+  }
+
+  ins->ext_size = ryvm_opcode_ext_size((enum ryvm_opcode) ins->opcode);
+
+  switch(ryvm_opcode_get_ins_format((enum ryvm_opcode) ins->opcode)) {
+    case RYVM_INS_FORMAT_R1:
+      if(ins->ext_size == 0) {
+        memcpy(ins->regs + 1, &value.u16, 2);
+      } else {
+        ins->regs[1] = 0;
+        ins->regs[2] = 0;
+      }
+      break;
+    case RYVM_INS_FORMAT_R2:
+      ins->regs[2] = ins->ext_size == 0 ? value.u8 : 0;
+      break;
+    default: assert(0);
+  }
+
+  if(ins->ext_size == 4 && !fits32 && bytewidth > 4) {
+    ryvm_assembler_error(asm_state, "Immediate does not fit in 32 bits!");
+    return 0;
+  }
+
+  return 1;
+}
+
+
 int ryvm_parse_text_entry(struct ryvm_assembler_state *asm_state, struct ryvm_token tok) {
   assert(asm_state->mode == RYVM_ASSEMBLER_MODE_TEXT);
   if(tok.tag == RYVM_TOKEN_LF || tok.tag == RYVM_TOKEN_EOF) {
@@ -569,6 +654,9 @@ int ryvm_parse_text_entry(struct ryvm_assembler_state *asm_state, struct ryvm_to
     struct ryvm_assembler_text_entry entry;
     entry.is_ins = 1;
     entry.d.ins.opcode = tok.d.opcode;
+    entry.d.ins.ext_size = 0;
+    entry.d.ins.ext = 0;
+    entry.d.ins.source_line = asm_state->lex.source_row;
 
     switch(ryvm_opcode_get_ins_format(tok.d.opcode)) {
 
@@ -608,11 +696,9 @@ int ryvm_parse_text_entry(struct ryvm_assembler_state *asm_state, struct ryvm_to
 
         tok = ryvm_lexer_get_token(&asm_state->lex);
         if(tok.tag == RYVM_TOKEN_INT_LITERAL ) {
-          uint16_t *imm = (uint16_t*) (entry.d.ins.regs + 1);
-          *imm = tok.d.num.u16;
-          entry.d.ins.has_placeholder = 0;
+          if(!ryvm_assembler_set_int_imm(asm_state, &entry.d.ins, tok.d.num)) return 0;
           
-        } else if(tok.tag == RYVM_TOKEN_LABEL_PC_OFF_EXPR) {
+        } else if(tok.tag == RYVM_TOKEN_LABEL_PC_OFF_EXPR && ryvm_opcode_ext_size(entry.d.ins.opcode) == 0) {
           entry.d.ins.placeholder = tok;
           entry.d.ins.has_placeholder = 1;
           if(!ryvm_assembler_add_label_expr(asm_state, tok.d.label_name)) return 0;
@@ -642,10 +728,9 @@ int ryvm_parse_text_entry(struct ryvm_assembler_state *asm_state, struct ryvm_to
 
         tok = ryvm_lexer_get_token(&asm_state->lex);
         if(tok.tag == RYVM_TOKEN_INT_LITERAL ) {
-          entry.d.ins.regs[2] = tok.d.num.u8;
-          entry.d.ins.has_placeholder = 0;
+          if(!ryvm_assembler_set_int_imm(asm_state, &entry.d.ins, tok.d.num)) return 0;
         
-        } else if(tok.tag == RYVM_TOKEN_LABEL_PC_OFF_EXPR) {
+        } else if(tok.tag == RYVM_TOKEN_LABEL_PC_OFF_EXPR && ryvm_opcode_ext_size(entry.d.ins.opcode) == 0) {
           entry.d.ins.placeholder = tok;
           entry.d.ins.has_placeholder = 1;
           if(!ryvm_assembler_add_label_expr(asm_state, tok.d.label_name)) return 0;
@@ -684,7 +769,7 @@ int ryvm_parse_text_entry(struct ryvm_assembler_state *asm_state, struct ryvm_to
       return 0;
     }
 
-    asm_state->current_relative_address += 4; //each instruction is 4 bytes
+    asm_state->current_relative_address += 4 + entry.d.ins.ext_size; //each instruction is 4 bytes, plus its extension words
 
    
 
@@ -776,6 +861,591 @@ int ryvm_assembler_pass1(struct ryvm_assembler_state *asm_state) {
 }
 
 
+/* Peephole Pass */
+
+//returns 1 if a label points at the relative address, meaning something may jump
+//into the middle of a sequence we want to fuse.
+int ryvm_assembler_is_label_target(struct ryvm_assembler_state *state, uint64_t rel_adr) {
+  for(uint64_t i = 0; i < state->labels.array_length; i++) {
+    struct ryvm_assembler_label *label = memory_array_builder_get_element_at(&state->labels, i);
+    if(label->relative_address == rel_adr) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//returns the instruction at index i of the text section, or NULL if that entry is raw data.
+struct ryvm_assembler_ins* ryvm_assembler_text_ins_at(struct ryvm_assembler_state *state, uint64_t i) {
+  struct ryvm_assembler_text_entry *e = memory_array_builder_get_element_at(&state->text, i);
+  return e != NULL && e->is_ins ? &e->d.ins : NULL;
+}
+
+int ryvm_assembler_text_entry_size(struct ryvm_assembler_text_entry *e) {
+  if(e->is_ins) {
+    return RYVM_INS_SIZE + e->d.ins.ext_size;
+  }
+  if(e->d.data.tag == RYVM_ASSEMBLER_DATA_ENTRY_TYPE_ASCII_Z) {
+    return strlen(e->d.data.d.ascii)+1;
+  }
+  return ryvm_assembler_data_entry_type_bytewidth(e->d.data.tag);
+}
+
+//returns 1 if any jump or PCR uses a literal offset instead of a label. Its target is not known until pass2,
+//so the peephole pass can neither remove instructions it might cross nor treat any subroutine as a leaf.
+//BR, BLR and RETW jump to a register.
+int ryvm_assembler_has_literal_pc_offset(struct ryvm_assembler_state *state) {
+  for(uint64_t i = 0; i < state->text.array_length; i++) {
+    struct ryvm_assembler_ins *ins = ryvm_assembler_text_ins_at(state, i);
+    if(ins != NULL && (ryvm_opcode_is_jump(ins->opcode) || ins->opcode == RYVM_OP_PCR) && !ins->has_placeholder
+      && ins->opcode != RYVM_OP_BR && ins->opcode != RYVM_OP_BLR && ins->opcode != RYVM_OP_RETW) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//returns the index of the text entry at the relative address, or the length of the text section if there is none.
+uint64_t ryvm_assembler_text_index_at(struct ryvm_assembler_state *state, uint64_t rel_adr) {
+  uint64_t adr = state->relative_address_text_section;
+  uint64_t i = 0;
+  while(i < state->text.array_length && adr < rel_adr) {
+    adr += ryvm_assembler_text_entry_size(memory_array_builder_get_element_at(&state->text, i));
+    i++;
+  }
+  return adr == rel_adr ? i : state->text.array_length;
+}
+
+//returns 1 if the SF register is written before it can be read when running from index i.
+//The scan follows B, and stops with 0 at any other jump, at raw data, or at anything that reads SF.
+//Reaching index stop also returns 1, since that is where the sequence being fused starts.
+int ryvm_assembler_flags_dead_at(struct ryvm_assembler_state *state, uint64_t i, uint64_t stop) {
+  for(uint64_t steps = 0; steps < state->text.array_length; steps++) {
+    if(i == stop) {
+      return 1;
+    }
+
+    struct ryvm_assembler_ins *ins = ryvm_assembler_text_ins_at(state, i);
+    if(ins == NULL) {
+      return 0;
+    }
+
+    enum ryvm_opcode op = ins->opcode;
+    uint8_t num_regs = ryvm_opcode_get_ins_format(op); //R0 to R3 have 0 to 3 registers
+    for(uint8_t r = 0; r < num_regs; r++) {
+      if((ins->regs[r] & 63) == RYVM_SF_REG) {
+        return 0;
+      }
+    }
+    if((op == RYVM_OP_STM || op == RYVM_OP_LDM) && (ins->regs[0] & 63) <= RYVM_SF_REG && (ins->regs[1] & 63) >= RYVM_SF_REG) {
+      return 0;
+    }
+
+    if(op == RYVM_OP_CPS || op == RYVM_OP_CPU || op == RYVM_OP_CPF || op == RYVM_OP_CPSI || op == RYVM_OP_CPUI) {
+      return 1;
+    }
+    if(op == RYVM_OP_SYS && !ins->has_placeholder && ins->regs[0] == 0 && ins->regs[1] == 0 && ins->regs[2] == 0) {
+      return 1; //SYS 0 exits, so nothing reads SF afterwards
+    }
+
+    if(op == RYVM_OP_B && ins->has_placeholder && ins->placeholder.tag == RYVM_TOKEN_LABEL_PC_OFF_EXPR) {
+      i = ryvm_assembler_text_index_at(state, ryvm_assembler_find_label(state, ins->placeholder.d.label_name)->relative_address);
+    } else if(ryvm_opcode_is_jump(op) || op == RYVM_OP_CSEL || op == RYVM_OP_CSINC) {
+      return 0;
+    } else {
+      i++;
+    }
+  }
+  return 0;
+}
+
+//returns the number of instructions that can be replaced by a single LOOP at index i, or 0 if there is no match.
+//The patterns are:
+//  SUBI Wn Wn 1
+//  CPSI Wn 0
+//  BNE #label
+//and
+//  SUBI Xn Xn 1
+//  CBNZ Xn #label
+//The CPSI form is only fused for W registers, since CPSI compares all 8 bytes of the register.
+//Unlike CPSI, LOOP does not write the SF register, so the CPSI form is only fused if both the code
+//after the loop and the start of its body write SF before reading it.
+uint8_t ryvm_assembler_match_loop(struct ryvm_assembler_state *state, uint64_t i, uint64_t rel_adr) {
+  struct ryvm_assembler_ins *sub = ryvm_assembler_text_ins_at(state, i);
+  if(sub == NULL || sub->opcode != RYVM_OP_SUBI || sub->has_placeholder || sub->regs[0] != sub->regs[1] || sub->regs[2] != 1) {
+    return 0;
+  }
+
+  struct ryvm_assembler_ins *next = ryvm_assembler_text_ins_at(state, i+1);
+  if(next == NULL || ryvm_assembler_is_label_target(state, rel_adr + 4)) {
+    return 0;
+  }
+
+  struct ryvm_assembler_ins *branch = next;
+  uint8_t num_ins = 2;
+
+  if(next->opcode == RYVM_OP_CPSI) {
+    //W registers have both access width bits set
+    if(next->has_placeholder || next->regs[0] != sub->regs[0] || (sub->regs[0] >> 6) != 3 || next->regs[1] != 0 || next->regs[2] != 0) {
+      return 0;
+    }
+
+    branch = ryvm_assembler_text_ins_at(state, i+2);
+    if(branch == NULL || branch->opcode != RYVM_OP_BNE || ryvm_assembler_is_label_target(state, rel_adr + 8)) {
+      return 0;
+    }
+    num_ins = 3;
+  } else if(next->opcode != RYVM_OP_CBNZ || next->regs[0] != sub->regs[0]) {
+    return 0;
+  }
+
+  if(!branch->has_placeholder || branch->placeholder.tag != RYVM_TOKEN_LABEL_PC_OFF_EXPR) {
+    return 0;
+  }
+
+  //removing instructions only moves the loop and its target closer together, so if the
+  //16-bit offset of LOOP can reach the label now, it can reach it after the pass.
+  struct ryvm_assembler_label *label = ryvm_assembler_find_label(state, branch->placeholder.d.label_name);
+  int16_t offset;
+  if(!ryvm_assembler_relative_pc_offset16(rel_adr, label->relative_address, &offset)) {
+    return 0;
+  }
+
+  if(num_ins == 3) {
+    uint64_t target = ryvm_assembler_text_index_at(state, label->relative_address);
+    if(!ryvm_assembler_flags_dead_at(state, i + 3, i) || !ryvm_assembler_flags_dead_at(state, target, i)) {
+      return 0;
+    }
+  }
+
+  return num_ins;
+}
+
+/* Call Rewrites */
+
+//the register byte of LR. Special registers are always accessed as W registers.
+#define RYVM_ASSEMBLER_LR_REG (0xC0 | RYVM_LR_REG)
+
+//returns 1 if the instruction never continues to the next instruction
+int ryvm_assembler_is_unconditional(struct ryvm_assembler_ins *ins) {
+  if(ins->opcode == RYVM_OP_SYS) {
+    return !ins->has_placeholder && ins->regs[0] == 0 && ins->regs[1] == 0 && ins->regs[2] == 0; //SYS 0
+  }
+  return ins->opcode == RYVM_OP_B || ins->opcode == RYVM_OP_BR || ins->opcode == RYVM_OP_RETW || ins->opcode == RYVM_OP_TCALLW;
+}
+
+int ryvm_assembler_is_callw_lr(struct ryvm_assembler_ins *ins) {
+  return ins->opcode == RYVM_OP_CALLW && ins->regs[0] == RYVM_ASSEMBLER_LR_REG
+    && ins->has_placeholder && ins->placeholder.tag == RYVM_TOKEN_LABEL_PC_OFF_EXPR;
+}
+
+int ryvm_assembler_is_retw_lr(struct ryvm_assembler_ins *ins) {
+  return ins->opcode == RYVM_OP_RETW && ins->regs[0] == RYVM_ASSEMBLER_LR_REG
+    && !ins->has_placeholder && ins->regs[1] == 0 && ins->regs[2] == 0;
+}
+
+//returns 1 if a subroutine must preserve the register under the calling convention, or if it is PC
+int ryvm_assembler_is_preserved_reg(uint8_t reg) {
+  uint8_t num = reg & 63;
+  return (num >= RYVM_CALLEE_SAVED_FIRST && num < RYVM_CALLEE_SAVED_FIRST + RYVM_CALLEE_SAVED_COUNT) || num >= RYVM_LR_REG;
+}
+
+//returns the label a placeholder refers to, or NULL if the placeholder is a literal
+struct ryvm_assembler_label* ryvm_assembler_placeholder_label(struct ryvm_assembler_state *state, struct ryvm_token *tok) {
+  if(tok->tag != RYVM_TOKEN_LABEL_ADR_OF_EXPR && tok->tag != RYVM_TOKEN_LABEL_PC_OFF_EXPR) {
+    return NULL;
+  }
+  return ryvm_assembler_find_label(state, tok->d.label_name);
+}
+
+//returns 1 if every use of a label between start_adr and end_adr (both inclusive) would still be
+//correct after the subroutine from index start to end becomes a leaf:
+//  - labels at start_adr may only be used by CALLW LR, or by jumps inside the subroutine.
+//  - labels after start_adr may only be used by jumps inside the subroutine.
+int ryvm_assembler_leaf_labels_used_safely(struct ryvm_assembler_state *state, uint64_t start, uint64_t end, uint64_t start_adr, uint64_t end_adr) {
+  for(uint64_t i = 0; i < state->text.array_length; i++) {
+    struct ryvm_assembler_text_entry *e = memory_array_builder_get_element_at(&state->text, i);
+    struct ryvm_token *tok;
+    if(e->is_ins && e->d.ins.has_placeholder) {
+      tok = &e->d.ins.placeholder;
+    } else if(!e->is_ins && e->d.data.using_placeholder) {
+      tok = &e->d.data.d.placeholder;
+    } else {
+      continue;
+    }
+
+    struct ryvm_assembler_label *label = ryvm_assembler_placeholder_label(state, tok);
+    if(label == NULL || label->relative_address < start_adr || label->relative_address > end_adr) {
+      continue;
+    }
+
+    uint8_t is_inner_jump = e->is_ins && i >= start && i <= end && tok->tag == RYVM_TOKEN_LABEL_PC_OFF_EXPR;
+    uint8_t is_call = e->is_ins && label->relative_address == start_adr && ryvm_assembler_is_callw_lr(&e->d.ins);
+    if(!is_inner_jump && !is_call) {
+      return 0;
+    }
+  }
+
+  //the address of a label stored in the data section could be used for an indirect call
+  for(uint64_t i = 0; i < state->data.array_length; i++) {
+    struct ryvm_assembler_data_entry *d = memory_array_builder_get_element_at(&state->data, i);
+    struct ryvm_assembler_label *label = d->using_placeholder ? ryvm_assembler_placeholder_label(state, &d->d.placeholder) : NULL;
+    if(label != NULL && label->relative_address >= start_adr && label->relative_address <= end_adr) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+//A leaf is a subroutine that has nothing for CALLW to save, so it can be called with BL and return with BR instead.
+//Returns the index of the RETW LR 0 that ends the subroutine starting at index start, or 0 if it is not a leaf. It must:
+//  - not be reachable by falling through from the previous instruction.
+//  - not call anything, or jump outside of itself.
+//  - not use W20-W39, LR, FP, SP, or PC, or STM and LDM, which can write a range of registers.
+uint64_t ryvm_assembler_match_leaf(struct ryvm_assembler_state *state, uint64_t start, uint64_t start_adr) {
+  struct ryvm_assembler_ins *prev = start > 0 ? ryvm_assembler_text_ins_at(state, start - 1) : NULL;
+  if(prev == NULL || !ryvm_assembler_is_unconditional(prev)) {
+    return 0;
+  }
+
+  uint64_t end = start;
+  uint64_t end_adr = start_adr;
+  while(1) {
+    struct ryvm_assembler_ins *ins = ryvm_assembler_text_ins_at(state, end);
+    if(ins == NULL) {
+      return 0;
+    }
+    if(ryvm_assembler_is_retw_lr(ins)) {
+      break;
+    }
+
+    enum ryvm_opcode op = ins->opcode;
+    if(op == RYVM_OP_BR || op == RYVM_OP_BL || op == RYVM_OP_BLR || op == RYVM_OP_CALLW || op == RYVM_OP_TCALLW 
+      || op == RYVM_OP_RETW || op == RYVM_OP_STM || op == RYVM_OP_LDM) {
+      return 0;
+    }
+
+    uint8_t num_regs = ryvm_opcode_get_ins_format(op); //R0 to R3 have 0 to 3 registers
+    for(uint8_t r = 0; r < num_regs; r++) {
+      if(ryvm_assembler_is_preserved_reg(ins->regs[r])) {
+        return 0;
+      }
+    }
+
+    end_adr += RYVM_INS_SIZE + ins->ext_size;
+    end++;
+  }
+
+  //every jump must stay inside the subroutine
+  for(uint64_t i = start; i < end; i++) {
+    struct ryvm_assembler_ins *ins = ryvm_assembler_text_ins_at(state, i);
+    if(ins->has_placeholder && ins->placeholder.tag == RYVM_TOKEN_LABEL_PC_OFF_EXPR) {
+      struct ryvm_assembler_label *label = ryvm_assembler_find_label(state, ins->placeholder.d.label_name);
+      if(label->relative_address < start_adr || label->relative_address > end_adr) {
+        return 0;
+      }
+    }
+  }
+
+  if(!ryvm_assembler_leaf_labels_used_safely(state, start, end, start_adr, end_adr)) {
+    return 0;
+  }
+  return end;
+}
+
+//returns 1 if a subroutine may start at the relative address: CALLW or TCALLW jumps there, or its address is taken.
+int ryvm_assembler_is_entry(struct ryvm_assembler_state *state, uint64_t rel_adr) {
+  for(uint64_t i = 0; i < state->text.array_length; i++) {
+    struct ryvm_assembler_text_entry *e = memory_array_builder_get_element_at(&state->text, i);
+    struct ryvm_token *tok;
+    if(e->is_ins && e->d.ins.has_placeholder) {
+      tok = &e->d.ins.placeholder;
+    } else if(!e->is_ins && e->d.data.using_placeholder) {
+      tok = &e->d.data.d.placeholder;
+    } else {
+      continue;
+    }
+
+    struct ryvm_assembler_label *label = ryvm_assembler_placeholder_label(state, tok);
+    if(label == NULL || label->relative_address != rel_adr) {
+      continue;
+    }
+    if(!e->is_ins || e->d.ins.opcode == RYVM_OP_CALLW || e->d.ins.opcode == RYVM_OP_TCALLW || !ryvm_opcode_is_jump(e->d.ins.opcode)) {
+      return 1;
+    }
+  }
+
+  for(uint64_t i = 0; i < state->data.array_length; i++) {
+    struct ryvm_assembler_data_entry *d = memory_array_builder_get_element_at(&state->data, i);
+    struct ryvm_assembler_label *label = d->using_placeholder ? ryvm_assembler_placeholder_label(state, &d->d.placeholder) : NULL;
+    if(label != NULL && label->relative_address == rel_adr) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//returns 1 if the instruction uses SP or FP
+int ryvm_assembler_uses_frame_regs(struct ryvm_assembler_ins *ins) {
+  uint8_t num_regs = ryvm_opcode_get_ins_format(ins->opcode); //R0 to R3 have 0 to 3 registers
+  for(uint8_t r = 0; r < num_regs; r++) {
+    uint8_t num = ins->regs[r] & 63;
+    if(num == RYVM_SP_REG || num == RYVM_FP_REG) {
+      return 1;
+    }
+  }
+  //STM and LDM write every register from their 1st to their 2nd one
+  return (ins->opcode == RYVM_OP_STM || ins->opcode == RYVM_OP_LDM) 
+    && (ins->regs[0] & 63) <= RYVM_SP_REG && (ins->regs[1] & 63) >= RYVM_FP_REG;
+}
+
+//returns 1 if the code from index start to end (both inclusive) can only be entered at start_adr by CALLW or TCALLW,
+//which both leave SP equal to FP, or by its own jumps. Any other use of a label in the range, such as a B from
+//another subroutine or a taken address, could reach the end with something on the stack.
+int ryvm_assembler_only_called_at(struct ryvm_assembler_state *state, uint64_t start, uint64_t end, uint64_t start_adr, uint64_t end_adr) {
+  for(uint64_t i = 0; i < state->text.array_length; i++) {
+    struct ryvm_assembler_text_entry *e = memory_array_builder_get_element_at(&state->text, i);
+    struct ryvm_token *tok;
+    if(e->is_ins && e->d.ins.has_placeholder) {
+      tok = &e->d.ins.placeholder;
+    } else if(!e->is_ins && e->d.data.using_placeholder) {
+      tok = &e->d.data.d.placeholder;
+    } else {
+      continue;
+    }
+
+    struct ryvm_assembler_label *label = ryvm_assembler_placeholder_label(state, tok);
+    if(label == NULL || label->relative_address < start_adr || label->relative_address > end_adr) {
+      continue;
+    }
+
+    uint8_t is_jump = e->is_ins && tok->tag == RYVM_TOKEN_LABEL_PC_OFF_EXPR && ryvm_opcode_is_jump(e->d.ins.opcode);
+    uint8_t is_inner_jump = is_jump && i >= start && i <= end;
+    uint8_t is_call = is_jump && label->relative_address == start_adr 
+      && (e->d.ins.opcode == RYVM_OP_CALLW || e->d.ins.opcode == RYVM_OP_TCALLW);
+    if(!is_inner_jump && !is_call) {
+      return 0;
+    }
+  }
+
+  for(uint64_t i = 0; i < state->data.array_length; i++) {
+    struct ryvm_assembler_data_entry *d = memory_array_builder_get_element_at(&state->data, i);
+    struct ryvm_assembler_label *label = d->using_placeholder ? ryvm_assembler_placeholder_label(state, &d->d.placeholder) : NULL;
+    if(label != NULL && label->relative_address >= start_adr && label->relative_address <= end_adr) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+//returns 1 if the subroutine making the call at index call has not used SP or FP since it started,
+//so SP still equals FP and nothing it owns is on the stack. It starts at the closest entry before
+//the call that cannot be reached by falling through from the instruction before it, and nothing
+//may jump into it from elsewhere, since the instructions run before the jump are not checked.
+int ryvm_assembler_frame_unused_before(struct ryvm_assembler_state *state, uint64_t call, uint64_t call_adr) {
+  uint64_t adr = call_adr;
+  for(uint64_t i = call; i > 0; i--) {
+    struct ryvm_assembler_ins *ins = ryvm_assembler_text_ins_at(state, i - 1);
+    if(ins == NULL || ryvm_assembler_uses_frame_regs(ins)) {
+      return 0;
+    }
+    adr -= RYVM_INS_SIZE + ins->ext_size;
+
+    struct ryvm_assembler_ins *prev = i > 1 ? ryvm_assembler_text_ins_at(state, i - 2) : NULL;
+    if(prev != NULL && ryvm_assembler_is_unconditional(prev) && ryvm_assembler_is_entry(state, adr)) {
+      return ryvm_assembler_only_called_at(state, i - 1, call, adr, call_adr);
+    }
+  }
+  return 0;
+}
+
+//finds a temporary register that no instruction uses, to hold the return address of calls to leaves.
+//LR cannot be used, since the caller may still need it. Returns 0 if every temporary is used.
+int ryvm_assembler_unused_link_reg(struct ryvm_assembler_state *state, uint8_t *reg) {
+  uint64_t used = 0; //bit n is set if register n is used
+
+  for(uint64_t i = 0; i < state->text.array_length; i++) {
+    struct ryvm_assembler_ins *ins = ryvm_assembler_text_ins_at(state, i);
+    if(ins == NULL) {
+      continue;
+    }
+
+    uint8_t num_regs = ryvm_opcode_get_ins_format(ins->opcode); //R0 to R3 have 0 to 3 registers
+    for(uint8_t r = 0; r < num_regs; r++) {
+      used |= 1ull << (ins->regs[r] & 63);
+    }
+    //STM and LDM use every register from their 1st to their 2nd one
+    if(ins->opcode == RYVM_OP_STM || ins->opcode == RYVM_OP_LDM) {
+      for(uint8_t r = ins->regs[0] & 63; r <= (ins->regs[1] & 63); r++) {
+        used |= 1ull << r;
+      }
+    }
+  }
+
+  //W40-W58 are tried first, since syscalls only use the lowest registers
+  for(uint8_t num = RYVM_SF_REG - 1; num >= 8; num--) {
+    if(!ryvm_assembler_is_preserved_reg(num) && !(used & (1ull << num))) {
+      *reg = 0xC0 | num;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//Replaces calls with cheaper ones. Instructions are only replaced, never removed, so no label moves:
+//  - CALLW LR #f becomes BL Wn #f, and the RETW LR 0 that ends f becomes BR Wn 0, if f is a leaf.
+//    Wn is a temporary register that is not used anywhere else (see ryvm_assembler_unused_link_reg).
+//  - CALLW LR #f followed by RETW LR 0 becomes B #f, if the caller has not used SP or FP before the call.
+//    f reuses the frame of the caller and its RETW returns straight to the caller's caller. Since f puts 
+//    its own locals at FP, the caller must not have anything on the stack.
+void ryvm_assembler_rewrite_calls(struct ryvm_assembler_state *state) {
+  uint8_t link_reg;
+  if(!ryvm_assembler_has_literal_pc_offset(state) && ryvm_assembler_unused_link_reg(state, &link_reg)) {
+    uint64_t rel_adr = state->relative_address_text_section;
+    for(uint64_t i = 0; i < state->text.array_length; i++) {
+      struct ryvm_assembler_text_entry *e = memory_array_builder_get_element_at(&state->text, i);
+      uint64_t start_adr = rel_adr;
+      rel_adr += ryvm_assembler_text_entry_size(e);
+
+      struct ryvm_assembler_ins *prev = i > 0 ? ryvm_assembler_text_ins_at(state, i - 1) : NULL;
+      if(!e->is_ins || prev == NULL || !ryvm_assembler_is_unconditional(prev) || !ryvm_assembler_is_label_target(state, start_adr)) {
+        continue;
+      }
+
+      uint64_t end = ryvm_assembler_match_leaf(state, i, start_adr);
+      if(end == 0) {
+        continue;
+      }
+
+      for(uint64_t j = 0; j < state->text.array_length; j++) {
+        struct ryvm_assembler_ins *call = ryvm_assembler_text_ins_at(state, j);
+        if(call != NULL && ryvm_assembler_is_callw_lr(call) && ryvm_assembler_find_label(state, call->placeholder.d.label_name)->relative_address == start_adr) {
+          call->opcode = RYVM_OP_BL;
+          call->regs[0] = link_reg;
+        }
+      }
+      struct ryvm_assembler_ins *ret = ryvm_assembler_text_ins_at(state, end);
+      ret->opcode = RYVM_OP_BR;
+      ret->regs[0] = link_reg;
+    }
+  }
+
+  //every call is checked before any is replaced, since CALLW is what marks where a subroutine starts.
+  //type: uint64_t, the index of each CALLW to replace
+  struct memory_array_builder tail_calls;
+  if(!memory_array_builder_init(&tail_calls, 16, sizeof(uint64_t), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
+    return; //the calls are still correct, just not as cheap
+  }
+
+  uint64_t rel_adr = state->relative_address_text_section;
+  for(uint64_t i = 0; i + 1 < state->text.array_length; i++) {
+    struct ryvm_assembler_text_entry *e = memory_array_builder_get_element_at(&state->text, i);
+    uint64_t call_adr = rel_adr;
+    rel_adr += ryvm_assembler_text_entry_size(e);
+
+    struct ryvm_assembler_ins *call = ryvm_assembler_text_ins_at(state, i);
+    struct ryvm_assembler_ins *ret = ryvm_assembler_text_ins_at(state, i + 1);
+    if(call != NULL && ret != NULL && ryvm_assembler_is_callw_lr(call) && ryvm_assembler_is_retw_lr(ret)
+      && ryvm_assembler_frame_unused_before(state, i, call_adr) && !memory_array_builder_append_element(&tail_calls, &i)) {
+      break;
+    }
+  }
+
+  for(uint64_t t = 0; t < tail_calls.array_length; t++) {
+    struct ryvm_assembler_ins *call = ryvm_assembler_text_ins_at(state, *(uint64_t*) memory_array_builder_get_element_at(&tail_calls, t));
+    call->opcode = RYVM_OP_B;
+    call->regs[0] = 0;
+  }
+  memory_array_builder_free(&tail_calls);
+}
+
+// The peephole pass runs between pass1 and pass2, while labels are still placeholders.
+// It replaces common instruction sequences with fused opcodes, then moves every label
+// after a removed instruction back so that pass2 computes the correct offsets.
+int ryvm_assembler_peephole(struct ryvm_assembler_state *state) {
+  ryvm_assembler_rewrite_calls(state);
+
+  struct memory_array_builder new_text;
+  if(!memory_array_builder_init(&new_text, 100, sizeof(struct ryvm_assembler_text_entry), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
+    printf("Cannot allocate memory for peephole pass!\n");
+    return 0;
+  }
+
+  //relative addresses are only compared with the original layout, so labels are moved at the end.
+  //type: uint64_t, the original relative address of each removed instruction
+  struct memory_array_builder removed;
+  if(!memory_array_builder_init(&removed, 16, sizeof(uint64_t), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
+    memory_array_builder_free(&new_text);
+    printf("Cannot allocate memory for peephole pass!\n");
+    return 0;
+  }
+
+  //a literal offset would still count the instructions a fused loop removes
+  uint8_t can_fuse = !ryvm_assembler_has_literal_pc_offset(state);
+
+  uint64_t rel_adr = state->relative_address_text_section;
+  uint64_t i = 0;
+  while(i < state->text.array_length) {
+    struct ryvm_assembler_text_entry *e = memory_array_builder_get_element_at(&state->text, i);
+    struct ryvm_assembler_text_entry out = *e;
+
+    uint8_t num_ins = can_fuse ? ryvm_assembler_match_loop(state, i, rel_adr) : 0;
+    if(num_ins > 0) {
+      struct ryvm_assembler_ins *branch = ryvm_assembler_text_ins_at(state, i + num_ins - 1);
+      out.d.ins.opcode = RYVM_OP_LOOP;
+      out.d.ins.regs[0] = e->d.ins.regs[0];
+      out.d.ins.regs[1] = 0;
+      out.d.ins.regs[2] = 0;
+      out.d.ins.has_placeholder = 1;
+      out.d.ins.placeholder = branch->placeholder;
+
+      for(uint8_t j = 1; j < num_ins; j++) {
+        uint64_t adr = rel_adr + j * RYVM_INS_SIZE;
+        if(!memory_array_builder_append_element(&removed, &adr)) {
+          goto fail;
+        }
+      }
+    } else {
+      num_ins = 1;
+    }
+
+    if(!memory_array_builder_append_element(&new_text, &out)) {
+      goto fail;
+    }
+
+    for(uint8_t j = 0; j < num_ins; j++) {
+      rel_adr += ryvm_assembler_text_entry_size(memory_array_builder_get_element_at(&state->text, i + j));
+    }
+    i += num_ins;
+  }
+
+  for(uint64_t l = 0; l < state->labels.array_length; l++) {
+    struct ryvm_assembler_label *label = memory_array_builder_get_element_at(&state->labels, l);
+    uint64_t shift = 0;
+    for(uint64_t r = 0; r < removed.array_length; r++) {
+      uint64_t *adr = memory_array_builder_get_element_at(&removed, r);
+      if(*adr < label->relative_address) {
+        shift += RYVM_INS_SIZE;
+      }
+    }
+    label->relative_address -= shift;
+  }
+
+  state->sizeof_text_section -= removed.array_length * RYVM_INS_SIZE;
+
+  memory_array_builder_free(&removed);
+  memory_array_builder_free(&state->text);
+  state->text = new_text;
+  return 1;
+
+  fail:
+  memory_array_builder_free(&removed);
+  memory_array_builder_free(&new_text);
+  printf("Cannot allocate memory for peephole pass!\n");
+  return 0;
+}
+
+
 /* Helper Functions for Pass 2 of the Assembler */
 
 int ryvm_assembler_add_reloc_entry(struct ryvm_assembler_state *state, uint64_t rel_adr_hole, uint64_t rel_adr_value) {
@@ -800,41 +1470,171 @@ int ryvm_assembler_add_reloc_entry(struct ryvm_assembler_state *state, uint64_t
   Binary Format:
 
   b2 magic_number
+  b1 flags (RYVM_IMAGE_FLAG_COMPRESSED if the text section is compressed)
+  b5 reserved (zero, keeps the data section 8-byte aligned inside the file)
   b8 max_stack_size
   b8 data_length_bytes
-  b(data_length_bytes) data
   b8 text_length_bytes
-  b(text_length_bytes) text
+  b(data_length_bytes) data
+  b(text_length_bytes) text (if compressed, the stream expands to text_length_bytes, see src/compress.h)
   b8 num_relocs
   b(num_relocs) relocation_entries
+
+  If flags has RYVM_IMAGE_FLAG_SYMBOLS, the symbol table follows (offsets are relative to the start of the text section):
+  b8 num_labels
+  num_labels times: b8 offset, then the null-terminated name of the label
+  b8 num_lines
+  num_lines times: b8 offset of an instruction, b4 the source line it came from
+
+  The data and text sections are stored next to each other so that a VM can 
+  run an image that is already in memory without copying it.
 */
-void ryvm_assembler_serialize_state_to_file(struct ryvm_assembler_state *state) {
-  FILE *f = state->output;
+void ryvm_assembler_write(struct ryvm_assembler_state *state, const void *bytes, size_t size) {
+  if(state->output != NULL) {
+    fwrite(bytes, size, 1, state->output);
+  } else {
+    memcpy(state->output_image + state->output_image_size, bytes, size);
+    state->output_image_size += size;
+  }
+}
 
-  //magic number
-  fwrite("RY", 2, 1, f);
+//write raw data into a compressed text section, splitting it into as many data units as needed
+void ryvm_assembler_write_compressed_data(struct ryvm_assembler_state *state, const void *bytes, size_t size) {
+  const uint8_t *b = bytes;
+  while(size > 0) {
+    uint16_t chunk = size > RYVM_COMPRESS_MAX_DATA ? RYVM_COMPRESS_MAX_DATA : (uint16_t) size;
+    uint8_t header[2];
+    ryvm_compress_data_header(chunk, header);
+    ryvm_assembler_write(state, header, 2);
+    ryvm_assembler_write(state, b, chunk);
+    b += chunk;
+    size -= chunk;
+  }
+}
 
-  //max_stack_size
-  fwrite(&state->config.max_stack_size, 8, 1, f);
+//write a data entry that is stored inside the text section
+void ryvm_assembler_write_text_data(struct ryvm_assembler_state *state, struct ryvm_assembler_data_entry *d) {
+  const void *bytes = &d->d.num;
+  size_t size;
+  if(d->tag == RYVM_ASSEMBLER_DATA_ENTRY_TYPE_ASCII_Z) {
+    bytes = d->d.ascii;
+    size = strlen(d->d.ascii)+1;
+  } else {
+    size = ryvm_assembler_data_entry_type_bytewidth(d->tag);
+  }
 
+  if(state->flags & RYVM_ASSEMBLER_FLAG_COMPRESS) {
+    ryvm_assembler_write_compressed_data(state, bytes, size);
+  } else {
+    ryvm_assembler_write(state, bytes, size);
+  }
+}
+
+//returns 1 if the label points inside the text section (or right after its last instruction)
+int ryvm_assembler_is_text_label(struct ryvm_assembler_state *state, struct ryvm_assembler_label *label) {
+  return label->relative_address >= state->relative_address_text_section
+    && label->relative_address <= state->relative_address_text_section + state->sizeof_text_section;
+}
+
+//returns the size of the symbol table written by ryvm_assembler_write_symbols
+size_t ryvm_assembler_symbols_size(struct ryvm_assembler_state *state) {
+  size_t size = 16;
+  for(uint64_t i = 0; i < state->labels.array_length; i++) {
+    struct ryvm_assembler_label *label = memory_array_builder_get_element_at(&state->labels, i);
+    if(ryvm_assembler_is_text_label(state, label)) {
+      size += 8 + strlen(label->label) + 1;
+    }
+  }
+  return size + state->text.array_length * 12;
+}
+
+void ryvm_assembler_write_symbols(struct ryvm_assembler_state *state) {
+  uint64_t num_labels = 0;
+  for(uint64_t i = 0; i < state->labels.array_length; i++) {
+    num_labels += ryvm_assembler_is_text_label(state, memory_array_builder_get_element_at(&state->labels, i));
+  }
+  ryvm_assembler_write(state, &num_labels, 8);
+
+  for(uint64_t i = 0; i < state->labels.array_length; i++) {
+    struct ryvm_assembler_label *label = memory_array_builder_get_element_at(&state->labels, i);
+    if(ryvm_assembler_is_text_label(state, label)) {
+      uint64_t offset = label->relative_address - state->relative_address_text_section;
+      ryvm_assembler_write(state, &offset, 8);
+      ryvm_assembler_write(state, label->label, strlen(label->label)+1);
+    }
+  }
+
+  uint64_t num_lines = 0;
+  for(uint64_t i = 0; i < state->text.array_length; i++) {
+    num_lines += ryvm_assembler_text_ins_at(state, i) != NULL;
+  }
+  ryvm_assembler_write(state, &num_lines, 8);
+
+  uint64_t offset = 0;
+  for(uint64_t i = 0; i < state->text.array_length; i++) {
+    struct ryvm_assembler_text_entry *e = memory_array_builder_get_element_at(&state->text, i);
+    if(e->is_ins) {
+      uint32_t line = (uint32_t) e->d.ins.source_line;
+      ryvm_assembler_write(state, &offset, 8);
+      ryvm_assembler_write(state, &line, 4);
+    }
+    offset += ryvm_assembler_text_entry_size(e);
+  }
+}
+
+int ryvm_assembler_serialize_state(struct ryvm_assembler_state *state) {
+  uint64_t data_size = state->relative_address_text_section; //since data section starts at 0 and ends at text section, the data size matches the starting relative address of the text section
+  uint64_t num_relocs = state->reloc_entries.array_length;
+
+  //when writing to memory, we know the exact size of the image, so allocate it once.
+  if(state->output == NULL) {
+    size_t total_size = RYVM_IMAGE_HEADER_SIZE + data_size + state->sizeof_text_section + 8 + num_relocs * 16;
+
+    //each data entry in a compressed text section needs a 2-byte header per RYVM_COMPRESS_MAX_DATA bytes
+    if(state->flags & RYVM_ASSEMBLER_FLAG_COMPRESS) {
+      total_size += 2 * (state->text.array_length + state->sizeof_text_section / RYVM_COMPRESS_MAX_DATA);
+    }
+    if(state->flags & RYVM_ASSEMBLER_FLAG_SYMBOLS) {
+      total_size += ryvm_assembler_symbols_size(state);
+    }
+    state->output_image = malloc(total_size);
+    state->output_image_size = 0;
+    if(state->output_image == NULL) {
+      printf("Cannot allocate memory for executable image!\n");
+      return 0;
+    }
+  }
+
+  //magic number and reserved bytes
+  uint8_t magic[8] = {'R', 'Y', 0, 0, 0, 0, 0, 0};
+  if(state->flags & RYVM_ASSEMBLER_FLAG_COMPRESS) {
+    magic[RYVM_IMAGE_FLAGS_OFFSET] |= RYVM_IMAGE_FLAG_COMPRESSED;
+  }
+  if(state->flags & RYVM_ASSEMBLER_FLAG_SYMBOLS) {
+    magic[RYVM_IMAGE_FLAGS_OFFSET] |= RYVM_IMAGE_FLAG_SYMBOLS;
+  }
+  ryvm_assembler_write(state, magic, 8);
+
+  //max_stack_size
+  ryvm_assembler_write(state, &state->config.max_stack_size, 8);
 
   //data_length_bytes
-  fwrite(&state->relative_address_text_section, 8, 1, f); //since data section starts at 0 and ends at text section, the data size matches the starting relative address of the text section
+  ryvm_assembler_write(state, &data_size, 8);
+
+  //write length (bytes) of text section
+  ryvm_assembler_write(state, &state->sizeof_text_section, 8);
 
 
-  //write data to file
+  //write data
   for(uint64_t i = 0; i < state->data.array_length; i++) {
     struct ryvm_assembler_data_entry *e = memory_array_builder_get_element_at(&state->data, i);
     if(e->tag == RYVM_ASSEMBLER_DATA_ENTRY_TYPE_ASCII_Z) {
-      fwrite(e->d.ascii, strlen(e->d.ascii)+1, 1, f);
+      ryvm_assembler_write(state, e->d.ascii, strlen(e->d.ascii)+1);
     } else {
-      fwrite(&e->d.num, ryvm_assembler_data_entry_type_bytewidth(e->tag), 1, f);
+      ryvm_assembler_write(state, &e->d.num, ryvm_assembler_data_entry_type_bytewidth(e->tag));
     }
   }
 
-  //write length (bytes) of text section
-  fwrite(&state->sizeof_text_section, 8, 1, f);
-
   //write all text entries
   for(uint64_t i = 0; i < state->text.array_length; i++) {
     struct ryvm_assembler_text_entry *e = memory_array_builder_get_element_at(&state->text, i);
@@ -845,26 +1645,35 @@ void ryvm_assembler_serialize_state_to_file(struct ryvm_assembler_state *state)
       ins[2] = e->d.ins.regs[1];
       ins[3] = e->d.ins.regs[2];
 
-      fwrite(ins, 4, 1, f);
-    } else {
-      if(e->d.data.tag == RYVM_ASSEMBLER_DATA_ENTRY_TYPE_ASCII_Z) {
-        fwrite(e->d.data.d.ascii, strlen(e->d.data.d.ascii)+1, 1, f);
-      } else {
-        fwrite(&e->d.data.d.num, ryvm_assembler_data_entry_type_bytewidth(e->d.data.tag), 1, f);
+      uint8_t compressed[2];
+      if((state->flags & RYVM_ASSEMBLER_FLAG_COMPRESS) && e->d.ins.ext_size == 0 && ryvm_compress_ins(ins, compressed)) {
+        ryvm_assembler_write(state, compressed, 2);
+        continue;
       }
+
+      ryvm_assembler_write(state, ins, 4);
+      ryvm_assembler_write(state, &e->d.ins.ext, e->d.ins.ext_size);
+    } else {
+      ryvm_assembler_write_text_data(state, &e->d.data);
     }
   }
 
   //num relocation entries (we don't need to do bytes since all entries are the same size in bytes)
-  fwrite(&state->reloc_entries.array_length, 8, 1, f);
+  ryvm_assembler_write(state, &num_relocs, 8);
 
 
   //write all relocation entries;
-  for(uint64_t i = 0; i < state->reloc_entries.array_length; i++) {
+  for(uint64_t i = 0; i < num_relocs; i++) {
     struct ryvm_assembler_reloc_entry *e = memory_array_builder_get_element_at(&state->reloc_entries, i);
-    fwrite(&e->hole_relative_address, 8, 1, f);
-    fwrite(&e->relative_address_value, 8, 1, f);
+    ryvm_assembler_write(state, &e->hole_relative_address, 8);
+    ryvm_assembler_write(state, &e->relative_address_value, 8);
   }
+
+  if(state->flags & RYVM_ASSEMBLER_FLAG_SYMBOLS) {
+    ryvm_assembler_write_symbols(state);
+  }
+
+  return 1;
 }
 
 
@@ -1002,7 +1811,7 @@ int ryvm_assembler_fill_placeholder_for_ins_entry(struct ryvm_assembler_state *s
    
   }
 
-  *rel_adr_ptr += 4;
+  *rel_adr_ptr += 4 + ins->ext_size;
 
   return 1;
 }
@@ -1044,79 +1853,119 @@ int ryvm_assembler_pass2(struct ryvm_assembler_state *state) {
     }
   }
 
-  ryvm_assembler_print(state);
+  if(state->print_program) {
+    ryvm_assembler_print(state);
+  }
 
   //Now that all relative addresses and offsets have been inserted and all relocation entries
-  //have been added successfully, we can finally serialize the assembler state to a file.
-  ryvm_assembler_serialize_state_to_file(state);
-
-  return 1;
+  //have been added successfully, we can finally serialize the assembler state.
+  return ryvm_assembler_serialize_state(state);
 
 
 
 }
 
 
-int ryvm_assemble_to_bytecode(FILE *in, FILE *out) {
-  struct ryvm_assembler_state asm_state;
-  asm_state.input = in;
-  asm_state.output = out;
-  asm_state.config.max_stack_size = 0;
-  asm_state.mode = RYVM_ASSEMBLER_MODE_CONFIG;
-  asm_state.failed = 0;
-  asm_state.current_relative_address = 0; 
+//runs both passes over the source code read by the lexer in asm_state. 
+//The lexer must already be initialized, and is freed along with the rest of the state.
+int ryvm_assembler_assemble(struct ryvm_assembler_state *asm_state) {
+  asm_state->config.max_stack_size = 0;
+  asm_state->mode = RYVM_ASSEMBLER_MODE_CONFIG;
+  asm_state->failed = 0;
+  asm_state->current_relative_address = 0; 
 
-  if(!memory_array_builder_init(&asm_state.labels, 100, sizeof(struct ryvm_assembler_label), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
+  if(!memory_array_builder_init(&asm_state->labels, 100, sizeof(struct ryvm_assembler_label), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
+    ryvm_lexer_free(&asm_state->lex);
     return 0;
   }
 
-  if(!ryvm_lexer_init(&asm_state.lex, in)) {
-    memory_array_builder_free(&asm_state.labels);
+  if(!memory_array_builder_init(&asm_state->data, 100, sizeof(struct ryvm_assembler_data_entry), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
+    memory_array_builder_free(&asm_state->labels);
+    ryvm_lexer_free(&asm_state->lex);
     return 0;
   }
 
-
-  if(!memory_array_builder_init(&asm_state.data, 100, sizeof(struct ryvm_assembler_data_entry), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
-    memory_array_builder_free(&asm_state.labels);
-    ryvm_lexer_free(&asm_state.lex);
+  if(!memory_array_builder_init(&asm_state->text, 100, sizeof(struct ryvm_assembler_text_entry), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
+    memory_array_builder_free(&asm_state->labels);
+    memory_array_builder_free(&asm_state->data);
+    ryvm_lexer_free(&asm_state->lex);
     return 0;
   }
 
-  if(!memory_array_builder_init(&asm_state.text, 100, sizeof(struct ryvm_assembler_text_entry), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
-    memory_array_builder_free(&asm_state.labels);
-    memory_array_builder_free(&asm_state.data);
-    ryvm_lexer_free(&asm_state.lex);
+  if(!memory_array_builder_init(&asm_state->reloc_entries, 100, sizeof(struct ryvm_assembler_reloc_entry), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
+    memory_array_builder_free(&asm_state->labels);
+    memory_array_builder_free(&asm_state->data);
+    memory_array_builder_free(&asm_state->text);
+    ryvm_lexer_free(&asm_state->lex);
     return 0;
   }
 
-  if(!memory_array_builder_init(&asm_state.reloc_entries, 100, sizeof(struct ryvm_assembler_reloc_entry), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
-    memory_array_builder_free(&asm_state.labels);
-    memory_array_builder_free(&asm_state.data);
-    memory_array_builder_free(&asm_state.text);
-    ryvm_lexer_free(&asm_state.lex);
+
+
+
+  if(!ryvm_assembler_pass1(asm_state) || asm_state->failed || asm_state->lex.lexer_failed) {
+    ryvm_assembler_free(asm_state);
     return 0;
   }
 
+  asm_state->sizeof_text_section = asm_state->current_relative_address - asm_state->relative_address_text_section;
 
+  if(!(asm_state->flags & RYVM_ASSEMBLER_FLAG_NO_PEEPHOLE) && !ryvm_assembler_peephole(asm_state)) {
+    ryvm_assembler_free(asm_state);
+    return 0;
+  }
+  
+  //ryvm_assembler_print(asm_state);
 
-
-  if(!ryvm_assembler_pass1(&asm_state)) {
+  if(!ryvm_assembler_pass2(asm_state)) {
+    ryvm_assembler_free(asm_state);
     return 0;
   }
 
-  if(asm_state.failed || asm_state.lex.lexer_failed) {
+  ryvm_assembler_free(asm_state);
+
+  return 1;
+}
+
+int ryvm_assemble_to_bytecode(FILE *in, FILE *out) {
+  return ryvm_assemble_to_bytecode_flags(in, out, RYVM_ASSEMBLER_FLAG_NONE);
+}
+
+int ryvm_assemble_to_bytecode_flags(FILE *in, FILE *out, uint32_t flags) {
+  struct ryvm_assembler_state asm_state;
+  asm_state.input = in;
+  asm_state.output = out;
+  asm_state.output_image = NULL;
+  asm_state.output_image_size = 0;
+  asm_state.print_program = 1;
+  asm_state.flags = flags;
+
+  if(!ryvm_lexer_init(&asm_state.lex, in)) {
     return 0;
   }
 
-  asm_state.sizeof_text_section = asm_state.current_relative_address - asm_state.relative_address_text_section;
-  
-  //ryvm_assembler_print(&asm_state);
+  return ryvm_assembler_assemble(&asm_state);
+}
 
-  if(!ryvm_assembler_pass2(&asm_state)) {
+int ryvm_assemble_buffer_to_image(const char *src, size_t src_len, uint8_t **image, size_t *image_size) {
+  struct ryvm_assembler_state asm_state;
+  asm_state.input = NULL;
+  asm_state.output = NULL;
+  asm_state.output_image = NULL;
+  asm_state.output_image_size = 0;
+  asm_state.print_program = 0;
+  asm_state.flags = RYVM_ASSEMBLER_FLAG_NONE;
+
+  if(!ryvm_lexer_init_buffer(&asm_state.lex, src, src_len)) {
     return 0;
   }
 
-  ryvm_assembler_free(&asm_state);
+  if(!ryvm_assembler_assemble(&asm_state)) {
+    free(asm_state.output_image);
+    return 0;
+  }
 
+  *image = asm_state.output_image;
+  *image_size = asm_state.output_image_size;
   return 1;
 }
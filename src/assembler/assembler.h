@@ -66,6 +66,12 @@ struct ryvm_assembler_ins {
   uint8_t regs[3];
   uint8_t has_placeholder;
   struct ryvm_token placeholder; //can be null. Each instruction may have only 1 placeholder (label expression, pc-offset expression, or Int/Float literal)
+
+  //the wide immediate written right after the instruction. ext_size is 0, 4, or 8 bytes (see ryvm_opcode_ext_size).
+  uint8_t ext_size;
+  uint64_t ext;
+
+  uint64_t source_line; //written to the symbol table when RYVM_ASSEMBLER_FLAG_SYMBOLS is set
 };
 
 
@@ -91,6 +97,21 @@ struct  ryvm_assembler_text_entry {
 
 
 
+enum ryvm_assembler_flag {
+  RYVM_ASSEMBLER_FLAG_NONE = 0,
+
+  //skip the peephole pass, so every instruction is emitted exactly as written.
+  RYVM_ASSEMBLER_FLAG_NO_PEEPHOLE = 1,
+
+  //store the most common instructions in 2 bytes (see src/compress.h). The VM expands them when loading.
+  RYVM_ASSEMBLER_FLAG_COMPRESS = 2,
+
+  //write a symbol table with the address of every text label and the source line of every instruction,
+  //which the VM uses to label its profile report.
+  RYVM_ASSEMBLER_FLAG_SYMBOLS = 4,
+};
+
+
 struct ryvm_assembler_config {
   uint64_t max_stack_size; //default is 1 MB
 };
@@ -133,10 +154,28 @@ struct ryvm_assembler_state {
   FILE *input;
   FILE *output;
 
+  //if output is NULL, the executable is written to this buffer instead.
+  uint8_t *output_image;
+  size_t output_image_size;
+
+  //print the assembled program to stdout after pass2
+  uint8_t print_program;
+
+  //ryvm_assembler_flag bits
+  uint32_t flags;
+
 };
 
 int ryvm_assemble_to_bytecode(FILE *in, FILE *out);
 
+//same as ryvm_assemble_to_bytecode, but with ryvm_assembler_flag bits to control the output.
+int ryvm_assemble_to_bytecode_flags(FILE *in, FILE *out, uint32_t flags);
+
+//assemble source code stored in memory without touching the file system.
+//On success, *image points to a malloc'ed executable of *image_size bytes, in the same 
+//format as a .ryc file. Pass it to ryvm_vm_load_image to run it, and free it once the VM is freed.
+int ryvm_assemble_buffer_to_image(const char *src, size_t src_len, uint8_t **image, size_t *image_size);
+
 
 #endif// RYVM_ASSEMBLER_H
 
@@ -10,7 +10,13 @@ char ryvm_lexer_read_char(struct ryvm_lexer *lexer) {
   lexer->reached_end_line = 0;
   lexer->reached_eof = 0;
 
-  char c = fgetc(lexer->src);
+  char c;
+  if(lexer->src_buf != NULL) {
+    c = lexer->src_buf_pos < lexer->src_buf_len ? lexer->src_buf[lexer->src_buf_pos++] : EOF;
+  } else {
+    c = fgetc(lexer->src);
+  }
+
   if(c == '\n') {
     lexer->source_col = 1;
     lexer->source_row++;
@@ -169,6 +175,9 @@ int ryvm_lexer_init(struct ryvm_lexer *lexer, FILE *src) {
   lexer->source_row = 1;
   lexer->source_col = 1;
   lexer->src = src;
+  lexer->src_buf = NULL;
+  lexer->src_buf_len = 0;
+  lexer->src_buf_pos = 0;
   lexer->lexer_failed = 0;
   lexer->reached_end_line = 0;
   lexer->reached_eof = 0;
@@ -204,6 +213,15 @@ int ryvm_lexer_init(struct ryvm_lexer *lexer, FILE *src) {
 
 }
 
+int ryvm_lexer_init_buffer(struct ryvm_lexer *lexer, const char *src, size_t src_len) {
+  if(!ryvm_lexer_init(lexer, NULL)) {
+    return 0;
+  }
+  lexer->src_buf = src;
+  lexer->src_buf_len = src_len;
+  return 1;
+}
+
 void ryvm_lexer_free(struct ryvm_lexer *lexer) {
   memory_array_builder_free(&lexer->temp_word);
   memory_free(lexer->mem);
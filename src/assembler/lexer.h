@@ -74,10 +74,19 @@ struct ryvm_lexer {
 
   FILE *src;
 
+  //if not NULL, source code is read from this buffer instead of src.
+  const char *src_buf;
+  size_t src_buf_len;
+  size_t src_buf_pos;
+
 };
 
 
 int ryvm_lexer_init(struct ryvm_lexer *lexer, FILE *src);
+
+//same as ryvm_lexer_init, but reads the source code from a buffer in memory. 
+//The buffer does not need to be null terminated, and must outlive the lexer.
+int ryvm_lexer_init_buffer(struct ryvm_lexer *lexer, const char *src, size_t src_len);
 void ryvm_lexer_free(struct ryvm_lexer *lexer);
 
 struct ryvm_token ryvm_lexer_get_token(struct ryvm_lexer *lexer);
@@ -2,34 +2,59 @@
 #include <stdlib.h>
 #include <string.h>
 #include "assembler.h"
+#include "../memory/memory.h"
+#include "../memory/pages.h"
 
 int main(int argc, char **argv) {
+  const char *paths[2];
+  int num_paths = 0;
+  uint32_t flags = RYVM_ASSEMBLER_FLAG_NONE;
 
-  if(argc != 3) {
+  for(int i = 1; i < argc; i++) {
+    //back the assembler's large buffers with huge pages
+    if(strcmp(argv[i], "--huge-pages") == 0) {
+      memory_set_default_page_flags(MEMORY_PAGE_FLAG_HUGE);
+    } else if(strcmp(argv[i], "--huge-pages=tlb") == 0) {
+      memory_set_default_page_flags(MEMORY_PAGE_FLAG_HUGETLBFS);
+    } else if(strcmp(argv[i], "--no-peephole") == 0) {
+      flags |= RYVM_ASSEMBLER_FLAG_NO_PEEPHOLE;
+    } else if(strcmp(argv[i], "--compress") == 0) {
+      flags |= RYVM_ASSEMBLER_FLAG_COMPRESS;
+    } else if(strcmp(argv[i], "-g") == 0) {
+      flags |= RYVM_ASSEMBLER_FLAG_SYMBOLS;
+    } else if(num_paths < 2) {
+      paths[num_paths++] = argv[i];
+    } else {
+      num_paths++;
+    }
+  }
+
+  if(num_paths != 2) {
     printf("Must have 2 arguments!\n");
+    printf("Usage: ryasm [--huge-pages | --huge-pages=tlb] [--no-peephole] [--compress] [-g] <input.ryasm> <output.ryc>\n");
     return 1;
   }
 
-  if(strcmp(argv[1], argv[2]) == 0) {
+  if(strcmp(paths[0], paths[1]) == 0) {
     printf("The input and output files cannot be identical!\n");
     return 1;
   }
 
   //grab file from argv
 
-  FILE *in = fopen(argv[1], "r");
+  FILE *in = fopen(paths[0], "r");
   if(in == NULL) {
-    printf("Cannot open input file %s\n", argv[1]);
+    printf("Cannot open input file %s\n", paths[0]);
     return 1;
   }
-  FILE *out = fopen(argv[2], "w");
+  FILE *out = fopen(paths[1], "w");
   if(out == NULL) {
     fclose(in);
-    printf("Cannot open output file %s\n", argv[2]);
+    printf("Cannot open output file %s\n", paths[1]);
     return 1;
   }
 
-  if(!ryvm_assemble_to_bytecode(in, out)) {
+  if(!ryvm_assemble_to_bytecode_flags(in, out, flags)) {
     printf("Cannot assembly bytecode!\n");
     fclose(in);
     fclose(out);
@@ -0,0 +1,241 @@
+#include "compress.h"
+#include "opcodes.h"
+#include "helper.h"
+#include <string.h>
+
+//compressed units are told apart from normal instructions by the MSB of the opcode byte,
+//so this fails to compile (with a negative array size) once an opcode no longer fits in 7 bits.
+typedef char ryvm_compress_opcodes_fit_in_7_bits[RYVM_OP_COUNT <= 128 ? 1 : -1];
+
+//the register byte of a W register has both access width bits set
+#define RYVM_COMPRESS_W_REG 0xC0
+
+static int ryvm_compress_is_w_reg(uint8_t reg) {
+  return (reg & RYVM_COMPRESS_W_REG) == RYVM_COMPRESS_W_REG;
+}
+
+static int ryvm_compress_fits(int32_t value, uint8_t bits) {
+  int32_t limit = 1 << (bits - 1);
+  return value >= -limit && value < limit;
+}
+
+//sign extend the lower bits of value
+static int32_t ryvm_compress_sign_extend(uint16_t value, uint8_t bits) {
+  int32_t v = value & ((1 << bits) - 1);
+  return v >= (1 << (bits - 1)) ? v - (1 << bits) : v;
+}
+
+static void ryvm_compress_unit(enum ryvm_compress_kind kind, uint16_t payload, uint8_t out[2]) {
+  uint16_t unit = 0x8000 | (kind << 11) | (payload & 0x7FF);
+  out[0] = unit >> 8;
+  out[1] = unit & 0xFF;
+}
+
+//PC-relative offsets are compressed as a number of instructions
+static int ryvm_compress_offset(int32_t offset, uint8_t bits, uint16_t *payload) {
+  if(offset % RYVM_INS_SIZE != 0 || !ryvm_compress_fits(offset / RYVM_INS_SIZE, bits)) {
+    return 0;
+  }
+  *payload = (uint16_t) (offset / RYVM_INS_SIZE) & ((1 << bits) - 1);
+  return 1;
+}
+
+int ryvm_compress_ins(const uint8_t ins[4], uint8_t out[2]) {
+  enum ryvm_opcode op = (enum ryvm_opcode) ins[0];
+  uint8_t reg = ins[1] & 63;
+  uint16_t payload;
+
+  switch(op) {
+    case RYVM_OP_ADDI:
+    case RYVM_OP_SUBI: {
+      int8_t imm = (int8_t) ins[3];
+      if(!ryvm_compress_is_w_reg(ins[1]) || !ryvm_compress_is_w_reg(ins[2])) {
+        return 0;
+      }
+
+      //a register to register move
+      if(op == RYVM_OP_ADDI && imm == 0 && ins[1] != ins[2] && reg < 32 && (ins[2] & 63) < 32) {
+        ryvm_compress_unit(RYVM_COMPRESS_KIND_MOV, (reg << 5) | (ins[2] & 63), out);
+        return 1;
+      }
+
+      if(ins[1] != ins[2] || !ryvm_compress_fits(imm, 5)) {
+        return 0;
+      }
+      ryvm_compress_unit(op == RYVM_OP_ADDI ? RYVM_COMPRESS_KIND_ADDI : RYVM_COMPRESS_KIND_SUBI, (reg << 5) | (imm & 31), out);
+      return 1;
+    }
+
+    case RYVM_OP_LDI: {
+      int16_t imm;
+      memcpy(&imm, ins + 2, 2);
+      if(!ryvm_compress_is_w_reg(ins[1]) || !ryvm_compress_fits(imm, 5)) {
+        return 0;
+      }
+      ryvm_compress_unit(RYVM_COMPRESS_KIND_LDI, (reg << 5) | (imm & 31), out);
+      return 1;
+    }
+
+    case RYVM_OP_B:
+    case RYVM_OP_BEQ:
+    case RYVM_OP_BNE:
+    case RYVM_OP_BLT:
+    case RYVM_OP_BGT:
+    case RYVM_OP_BLE:
+    case RYVM_OP_BGE: {
+      int32_t offset = ryvm_vm_helper_cast_int_24_to_32((uint8_t*) ins + 1);
+      if(!ryvm_compress_offset(offset, 11, &payload)) {
+        return 0;
+      }
+      ryvm_compress_unit(RYVM_COMPRESS_KIND_B + (op - RYVM_OP_B), payload, out);
+      return 1;
+    }
+
+    case RYVM_OP_SYS: {
+      uint32_t num = ins[1] | (ins[2] << 8) | ((uint32_t) ins[3] << 16);
+      if(num > 0x7FF) {
+        return 0;
+      }
+      ryvm_compress_unit(RYVM_COMPRESS_KIND_SYS, num, out);
+      return 1;
+    }
+
+    case RYVM_OP_LOOP: {
+      int16_t offset;
+      memcpy(&offset, ins + 2, 2);
+      if(!ryvm_compress_is_w_reg(ins[1]) || !ryvm_compress_offset(offset, 5, &payload)) {
+        return 0;
+      }
+      ryvm_compress_unit(RYVM_COMPRESS_KIND_LOOP, (reg << 5) | payload, out);
+      return 1;
+    }
+
+    case RYVM_OP_BR: {
+      if(!ryvm_compress_is_w_reg(ins[1]) || ins[2] != 0 || ins[3] != 0) {
+        return 0;
+      }
+      ryvm_compress_unit(RYVM_COMPRESS_KIND_BR, reg, out);
+      return 1;
+    }
+
+    default:
+      return 0;
+  }
+}
+
+void ryvm_compress_data_header(uint16_t size, uint8_t out[2]) {
+  ryvm_compress_unit(RYVM_COMPRESS_KIND_DATA, size, out);
+}
+
+//turn a 2-byte unit (other than raw data) back into its 4-byte instruction
+static int ryvm_compress_expand_unit(enum ryvm_compress_kind kind, uint16_t payload, uint8_t ins[4]) {
+  uint8_t reg = RYVM_COMPRESS_W_REG | (payload >> 5);
+  int32_t small_imm = ryvm_compress_sign_extend(payload, 5);
+  memset(ins, 0, 4);
+
+  switch(kind) {
+    case RYVM_COMPRESS_KIND_ADDI:
+    case RYVM_COMPRESS_KIND_SUBI:
+      ins[0] = kind == RYVM_COMPRESS_KIND_ADDI ? RYVM_OP_ADDI : RYVM_OP_SUBI;
+      ins[1] = reg;
+      ins[2] = reg;
+      ins[3] = (uint8_t) small_imm;
+      return 1;
+
+    case RYVM_COMPRESS_KIND_MOV:
+      ins[0] = RYVM_OP_ADDI;
+      ins[1] = RYVM_COMPRESS_W_REG | ((payload >> 5) & 31);
+      ins[2] = RYVM_COMPRESS_W_REG | (payload & 31);
+      return 1;
+
+    case RYVM_COMPRESS_KIND_LDI: {
+      int16_t imm = (int16_t) small_imm;
+      ins[0] = RYVM_OP_LDI;
+      ins[1] = reg;
+      memcpy(ins + 2, &imm, 2);
+      return 1;
+    }
+
+    case RYVM_COMPRESS_KIND_SYS:
+      ins[0] = RYVM_OP_SYS;
+      ins[1] = payload & 0xFF;
+      ins[2] = payload >> 8;
+      return 1;
+
+    case RYVM_COMPRESS_KIND_LOOP: {
+      int16_t offset = (int16_t) (small_imm * RYVM_INS_SIZE);
+      ins[0] = RYVM_OP_LOOP;
+      ins[1] = reg;
+      memcpy(ins + 2, &offset, 2);
+      return 1;
+    }
+
+    case RYVM_COMPRESS_KIND_BR:
+      ins[0] = RYVM_OP_BR;
+      ins[1] = RYVM_COMPRESS_W_REG | (payload & 63);
+      return 1;
+
+    default:
+      break;
+  }
+
+  //B to BGE
+  if(kind >= RYVM_COMPRESS_KIND_B && kind <= RYVM_COMPRESS_KIND_B + (RYVM_OP_BGE - RYVM_OP_B)) {
+    int32_t offset = ryvm_compress_sign_extend(payload, 11) * RYVM_INS_SIZE;
+    ins[0] = RYVM_OP_B + (kind - RYVM_COMPRESS_KIND_B);
+    ins[1] = offset & 0xFF;
+    ins[2] = (offset >> 8) & 0xFF;
+    ins[3] = (offset >> 16) & 0xFF;
+    return 1;
+  }
+
+  return 0;
+}
+
+size_t ryvm_compress_expand(const uint8_t *src, size_t src_size, uint8_t *dest, uint64_t text_size) {
+  size_t read = 0;
+  uint64_t written = 0;
+
+  while(written < text_size) {
+    if(read >= src_size) {
+      return 0;
+    }
+
+    //a normal instruction and its extension words
+    if((src[read] & 0x80) == 0) {
+      size_t size = RYVM_INS_SIZE + ryvm_opcode_ext_size((enum ryvm_opcode) src[read]);
+      if(read + size > src_size || written + size > text_size) {
+        return 0;
+      }
+      memcpy(dest + written, src + read, size);
+      read += size;
+      written += size;
+      continue;
+    }
+
+    if(read + 2 > src_size) {
+      return 0;
+    }
+    uint16_t unit = (src[read] << 8) | src[read + 1];
+    enum ryvm_compress_kind kind = (unit >> 11) & 15;
+    uint16_t payload = unit & 0x7FF;
+    read += 2;
+
+    if(kind == RYVM_COMPRESS_KIND_DATA) {
+      if(read + payload > src_size || written + payload > text_size) {
+        return 0;
+      }
+      memcpy(dest + written, src + read, payload);
+      read += payload;
+      written += payload;
+      continue;
+    }
+
+    if(written + RYVM_INS_SIZE > text_size || !ryvm_compress_expand_unit(kind, payload, dest + written)) {
+      return 0;
+    }
+    written += RYVM_INS_SIZE;
+  }
+
+  return read;
+}
@@ -0,0 +1,44 @@
+#ifndef RYVM_COMPRESS_H
+#define RYVM_COMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Compressed text sections. The most frequent instruction forms are stored in 2 bytes instead of 4.
+//Compression only changes how the text section is stored in a .ryc image. The loader expands it
+//back to the normal 4-byte encoding, so every PC-relative offset and relative address stays the same.
+//
+//A compressed text section is a stream of units. The MSB of the first byte tells them apart,
+//since every opcode is less than 128 (checked at compile time in compress.c):
+//  - 0xxxxxxx: a normal instruction, stored as is (4 bytes plus its extension words).
+//  - 1cccc ppp pppppppp: a 2-byte unit with a 4-bit kind (c) and an 11-bit payload (p).
+//    The first byte holds the upper bits.
+//  - kind 15: raw data (from .eword, .asciz, etc). The payload is the number of bytes that follow.
+//
+//All register numbers in the compressed forms are W registers.
+enum ryvm_compress_kind {
+  RYVM_COMPRESS_KIND_ADDI = 0,  //ADDI Wr Wr imm  ; payload: r (6 bits), imm (signed 5 bits)
+  RYVM_COMPRESS_KIND_SUBI = 1,  //SUBI Wr Wr imm  ; payload: r (6 bits), imm (signed 5 bits)
+  RYVM_COMPRESS_KIND_MOV = 2,   //ADDI Wd Ws 0    ; payload: d (5 bits), s (5 bits). Only registers 0-31
+  RYVM_COMPRESS_KIND_LDI = 3,   //LDI Wr imm      ; payload: r (6 bits), imm (signed 5 bits)
+  RYVM_COMPRESS_KIND_B = 4,     //B to BGE        ; payload: offset / 4 (signed 11 bits). Kinds 4-10 follow the opcode order
+  RYVM_COMPRESS_KIND_SYS = 11,  //SYS imm         ; payload: imm (11 bits)
+  RYVM_COMPRESS_KIND_LOOP = 12, //LOOP Wr imm     ; payload: r (6 bits), offset / 4 (signed 5 bits)
+  RYVM_COMPRESS_KIND_BR = 13,   //BR Wr 0         ; payload: r (6 bits)
+  RYVM_COMPRESS_KIND_DATA = 15,
+};
+
+//the largest number of raw data bytes a single data unit can hold
+#define RYVM_COMPRESS_MAX_DATA 2047
+
+//try to compress a 4-byte instruction. Returns 1 and writes 2 bytes to out if it has a compressed form.
+int ryvm_compress_ins(const uint8_t ins[4], uint8_t out[2]);
+
+//write the header of a raw data unit holding size bytes (at most RYVM_COMPRESS_MAX_DATA) to out.
+void ryvm_compress_data_header(uint16_t size, uint8_t out[2]);
+
+//expand a compressed text section from src into dest, which must hold exactly text_size bytes.
+//Returns the number of bytes read from src, or 0 if the stream is invalid.
+size_t ryvm_compress_expand(const uint8_t *src, size_t src_size, uint8_t *dest, uint64_t text_size);
+
+#endif // RYVM_COMPRESS_H
@@ -1,4 +1,5 @@
 #include "helper.h"
+#include "minifloat.h"
 #include <string.h>
 #include <assert.h>
 
@@ -9,15 +10,20 @@ float ryvm_vm_helper_reg_to_float(uint64_t reg_value, uint8_t bytewidth) {
   float res;
 
   //if we want all 8 bytes of register
-  if(bytewidth >= 4) {
+  if(bytewidth > 4) {
     double d;
     memcpy(&d, &reg_value, 8);
     res = (float) d; //precison loss, but we dont care
   }
-  //TODO: Implement half precision floating point and come up with a 8-bit "minifloat"
-  else {
+  else if(bytewidth == 4) {
     memcpy(&res, &reg_value, 4);
   }
+  else if(bytewidth == 2) {
+    res = ryvm_minifloat_f16_to_f32((uint16_t) reg_value);
+  }
+  else {
+    res = ryvm_minifloat_fp8_to_f32((uint8_t) reg_value);
+  }
 
   return res;
 }
@@ -28,19 +34,31 @@ double ryvm_vm_helper_reg_to_double(uint64_t reg_value, uint8_t bytewidth) {
   double res;
 
   //if we want all 8 bytes of register
-  if(bytewidth >= 4) {
+  if(bytewidth > 4) {
     memcpy(&res, &reg_value, 8);
   }
-  //TODO: Implement half precision floating point and come up with a 8-bit "minifloat"
+  //every smaller format converts to a double exactly
   else {
-    float f;
-    memcpy(&f, &reg_value, 4);
-    res = (double) f;
+    res = (double) ryvm_vm_helper_reg_to_float(reg_value, bytewidth);
   }
 
   return res;
 }
 
+uint64_t ryvm_vm_helper_float_to_reg(float value, uint8_t bytewidth) {
+  assert(bytewidth == 1 || bytewidth == 2 || bytewidth == 4);
+
+  uint64_t res = 0;
+  if(bytewidth == 4) {
+    memcpy(&res, &value, 4);
+  } else if(bytewidth == 2) {
+    res = ryvm_minifloat_f32_to_f16(value);
+  } else {
+    res = ryvm_minifloat_f32_to_fp8(value);
+  }
+  return res;
+}
+
 int64_t ryvm_vm_helper_sign_extend_64(uint8_t *bytes, uint8_t num_bytes) {
   assert(num_bytes <= 8);
   int64_t res;
@@ -86,3 +104,145 @@ int32_t ryvm_vm_helper_cast_int_24_to_32(uint8_t bytes[3]) {
 
   return value;
 }
+
+
+#if defined(__GNUC__)
+
+uint8_t ryvm_vm_helper_popcount_64(uint64_t value) {
+  return (uint8_t) __builtin_popcountll(value);
+}
+
+uint8_t ryvm_vm_helper_clz_64(uint64_t value) {
+  return (uint8_t) __builtin_clzll(value);
+}
+
+uint8_t ryvm_vm_helper_ctz_64(uint64_t value) {
+  return (uint8_t) __builtin_ctzll(value);
+}
+
+uint64_t ryvm_vm_helper_bswap_64(uint64_t value) {
+  return __builtin_bswap64(value);
+}
+
+#else
+
+uint8_t ryvm_vm_helper_popcount_64(uint64_t value) {
+  value = value - ((value >> 1) & 0x5555555555555555ULL);
+  value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+  value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (uint8_t) ((value * 0x0101010101010101ULL) >> 56);
+}
+
+uint8_t ryvm_vm_helper_clz_64(uint64_t value) {
+  uint8_t count = 0;
+  while((value & (1ULL << 63)) == 0) {
+    value <<= 1;
+    count++;
+  }
+  return count;
+}
+
+uint8_t ryvm_vm_helper_ctz_64(uint64_t value) {
+  uint8_t count = 0;
+  while((value & 1) == 0) {
+    value >>= 1;
+    count++;
+  }
+  return count;
+}
+
+uint64_t ryvm_vm_helper_bswap_64(uint64_t value) {
+  uint64_t res = 0;
+  for(uint8_t i = 0; i < 8; i++) {
+    res = (res << 8) | (value & 0xFF);
+    value >>= 8;
+  }
+  return res;
+}
+
+#endif
+
+
+#if defined(__SIZEOF_INT128__)
+
+//__int128 is an extension, so mark it as one to keep -pedantic quiet
+__extension__ typedef unsigned __int128 ryvm_vm_helper_uint128;
+__extension__ typedef __int128 ryvm_vm_helper_int128;
+
+void ryvm_vm_helper_mul_128(uint64_t a, uint64_t b, uint8_t is_signed, uint64_t *low, uint64_t *high) {
+  ryvm_vm_helper_uint128 product;
+  if(is_signed) {
+    product = (ryvm_vm_helper_uint128) ((ryvm_vm_helper_int128) (int64_t) a * (int64_t) b);
+  } else {
+    product = (ryvm_vm_helper_uint128) a * b;
+  }
+  *low = (uint64_t) product;
+  *high = (uint64_t) (product >> 64);
+}
+
+void ryvm_vm_helper_udiv_128(uint64_t high, uint64_t low, uint64_t divisor, uint64_t *quotient_high, uint64_t *quotient_low, uint64_t *remainder) {
+  ryvm_vm_helper_uint128 dividend = ((ryvm_vm_helper_uint128) high << 64) | low;
+  ryvm_vm_helper_uint128 quotient = dividend / divisor;
+  *quotient_high = (uint64_t) (quotient >> 64);
+  *quotient_low = (uint64_t) quotient;
+  *remainder = (uint64_t) (dividend % divisor);
+}
+
+#else
+
+void ryvm_vm_helper_mul_128(uint64_t a, uint64_t b, uint8_t is_signed, uint64_t *low, uint64_t *high) {
+  //schoolbook multiplication using 32-bit halves, so no partial product overflows
+  uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+  uint64_t b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+
+  uint64_t lo_lo = a_lo * b_lo;
+  uint64_t hi_lo = a_hi * b_lo;
+  uint64_t lo_hi = a_lo * b_hi;
+  uint64_t hi_hi = a_hi * b_hi;
+
+  uint64_t middle = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  *low = (middle << 32) | (lo_lo & 0xFFFFFFFF);
+  *high = hi_hi + (hi_lo >> 32) + (middle >> 32);
+
+  //a negative operand was treated as (operand + 2^64), so take away the extra (other operand * 2^64)
+  if(is_signed) {
+    if((int64_t) a < 0) {
+      *high -= b;
+    }
+    if((int64_t) b < 0) {
+      *high -= a;
+    }
+  }
+}
+
+void ryvm_vm_helper_udiv_128(uint64_t high, uint64_t low, uint64_t divisor, uint64_t *quotient_high, uint64_t *quotient_low, uint64_t *remainder) {
+  //shift-and-subtract long division, 1 bit of the quotient at a time
+  uint64_t rem = 0;
+  *quotient_high = 0;
+  *quotient_low = 0;
+  for(int i = 127; i >= 0; i--) {
+    uint64_t bit = i >= 64 ? (high >> (i - 64)) & 1 : (low >> i) & 1;
+    uint8_t overflow = (rem >> 63) != 0;
+    rem = (rem << 1) | bit;
+    if(overflow || rem >= divisor) {
+      rem -= divisor;
+      if(i >= 64) {
+        *quotient_high |= 1ULL << (i - 64);
+      } else {
+        *quotient_low |= 1ULL << i;
+      }
+    }
+  }
+  *remainder = rem;
+}
+
+#endif
+
+
+double ryvm_vm_helper_pow2(int16_t exponent) {
+  //a power of 2 has a mantissa of 0, so only the biased exponent needs to be set
+  uint64_t bits = (uint64_t) (exponent + 1023) << 52;
+  double res;
+  memcpy(&res, &bits, 8);
+  return res;
+}
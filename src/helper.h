@@ -17,21 +17,57 @@
 #define RYVM_LR_REG 60  // link register
 #define RYVM_SF_REG 59  // status flag register (similar to RFLAGS on x86-64 and CPSR on ARM64)
 
+//registers a subroutine must preserve under the calling convention (W20-W39). CALLW and RETW save and restore them.
+#define RYVM_CALLEE_SAVED_FIRST 20
+#define RYVM_CALLEE_SAVED_COUNT 20
+
+//bytes pushed by CALLW: the callee-saved registers, then LR and FP
+#define RYVM_CALL_FRAME_SIZE ((RYVM_CALLEE_SAVED_COUNT + 2) * 8)
+
 
 #define RYVM_INS_SIZE 4
 
+//size of the header at the start of a .ryc image (magic number, stack size, data size, text size)
+#define RYVM_IMAGE_HEADER_SIZE 32
+
+//the byte after the magic number holds flags describing the image.
+#define RYVM_IMAGE_FLAGS_OFFSET 2
+#define RYVM_IMAGE_FLAG_COMPRESSED 1 //the text section is compressed (see compress.h)
+#define RYVM_IMAGE_FLAG_SYMBOLS 2    //a symbol table follows the relocation table (see vm/symbols.h)
 
+
+//Float registers hold a different format depending on their bytewidth:
+//W = 64-bit double, H = 32-bit float, Q = IEEE half precision (f16), E = 8-bit FP8 E4M3 (see minifloat.h)
 float ryvm_vm_helper_reg_to_float(uint64_t reg_value, uint8_t bytewidth);
 
 
 double ryvm_vm_helper_reg_to_double(uint64_t reg_value, uint8_t bytewidth);
 
+//convert a float to the format used by registers with a bytewidth of 1, 2, or 4 bytes.
+//Only the lowest bytewidth bytes of the result are used.
+uint64_t ryvm_vm_helper_float_to_reg(float value, uint8_t bytewidth);
+
 
 
 
 int64_t ryvm_vm_helper_sign_extend_64(uint8_t *bytes, uint8_t num_bytes);
 int32_t ryvm_vm_helper_cast_int_24_to_32(uint8_t bytes[3]);
 
+//bit manipulation. These use compiler builtins when available, which become a single instruction on most CPUs.
+uint8_t ryvm_vm_helper_popcount_64(uint64_t value);
+uint8_t ryvm_vm_helper_clz_64(uint64_t value); //value must not be 0
+uint8_t ryvm_vm_helper_ctz_64(uint64_t value); //value must not be 0
+uint64_t ryvm_vm_helper_bswap_64(uint64_t value);
+
+//compute the full 128-bit product of a and b, treating them as signed if is_signed is not 0
+void ryvm_vm_helper_mul_128(uint64_t a, uint64_t b, uint8_t is_signed, uint64_t *low, uint64_t *high);
+
+//divide the unsigned 128-bit number (high, low) by divisor, which must not be 0.
+void ryvm_vm_helper_udiv_128(uint64_t high, uint64_t low, uint64_t divisor, uint64_t *quotient_high, uint64_t *quotient_low, uint64_t *remainder);
+
+//returns 2^exponent by building the bits of the double directly. exponent must be within -1022 to 1023.
+double ryvm_vm_helper_pow2(int16_t exponent);
+
 
 
 #endif // RYVM_HELPER_H
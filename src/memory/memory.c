@@ -1,13 +1,42 @@
 #include "memory.h"
+#include "pages.h"
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 
 
+//page flags used for regions that are large enough to be backed by huge pages.
+uint32_t memory_default_page_flags = MEMORY_PAGE_FLAG_NONE;
+
+void memory_set_default_page_flags(uint32_t flags) {
+  memory_default_page_flags = flags;
+}
+
+//allocate the memory block of a region. Large blocks come directly from the OS when
+//huge pages were requested, everything else comes from malloc.
+char* memory_region_data_alloc(size_t capacity, uint32_t *page_flags) {
+  if(memory_default_page_flags != MEMORY_PAGE_FLAG_NONE && capacity >= MEMORY_PAGES_HUGE_SIZE) {
+    *page_flags = memory_default_page_flags;
+    return memory_pages_alloc(capacity, memory_default_page_flags);
+  }
+
+  *page_flags = MEMORY_PAGE_FLAG_NONE;
+  return malloc(capacity);
+}
+
+void memory_region_data_free(char *data_ptr, size_t capacity, uint32_t page_flags) {
+  if(page_flags != MEMORY_PAGE_FLAG_NONE) {
+    memory_pages_free(data_ptr, capacity, page_flags);
+  } else {
+    free(data_ptr);
+  }
+}
+
+
 int memory_region_linked_list_init(struct memory_region_linked_list* region, size_t capacity) {
   region->capacity = capacity;
   region->current_size = 0;
-  region->data_ptr = malloc(capacity);
+  region->data_ptr = memory_region_data_alloc(capacity, &region->page_flags);
   region->next = NULL; //sentinal value for end of list
 
   if(region->data_ptr == NULL) {
@@ -47,7 +76,7 @@ struct memory_allocator* memory_create(size_t capacity, enum memory_allocator_ta
     case MEMORY_ALLOCATOR_REGION_REALLOC: {
       alloc->d.region_realloc.capacity = capacity;
       alloc->d.region_realloc.current_size = 0;
-      alloc->d.region_realloc.data_ptr = malloc(capacity);
+      alloc->d.region_realloc.data_ptr = memory_region_data_alloc(capacity, &alloc->d.region_realloc.page_flags);
 
       if(alloc->d.region_realloc.data_ptr == NULL) {
         free(alloc);
@@ -73,8 +102,24 @@ struct memory_allocator* memory_create(size_t capacity, enum memory_allocator_ta
 }
 
 int memory_region_realloc_expand(struct memory_region_realloc *region, size_t new_size) {
+  char *new_ptr;
+
+  if(region->page_flags != MEMORY_PAGE_FLAG_NONE) {
+    new_ptr = memory_pages_realloc(region->data_ptr, region->capacity, new_size, region->page_flags);
+  } 
+  //once the region grows large enough, move it out of malloc and into huge pages.
+  else if(memory_default_page_flags != MEMORY_PAGE_FLAG_NONE && new_size >= MEMORY_PAGES_HUGE_SIZE) {
+    new_ptr = memory_pages_alloc(new_size, memory_default_page_flags);
+    if(new_ptr != NULL) {
+      memcpy(new_ptr, region->data_ptr, region->current_size);
+      free(region->data_ptr);
+      region->page_flags = memory_default_page_flags;
+    }
+  } 
+  else {
+    new_ptr = realloc(region->data_ptr, new_size);
+  }
 
-  char *new_ptr = realloc(region->data_ptr, new_size);
   if(new_ptr == NULL) {
     return 0;
   }
@@ -371,7 +416,7 @@ void memory_free(struct memory_allocator *alloc) {
       struct memory_region_linked_list *region = alloc->d.region_linked_list.next;
 
       while(region != NULL) {
-        free(region->data_ptr);
+        memory_region_data_free(region->data_ptr, region->capacity, region->page_flags);
         struct memory_region_linked_list *child = region->next; //grab pointer before it is lost
         free(region);
     
@@ -379,13 +424,13 @@ void memory_free(struct memory_allocator *alloc) {
       }
 
       //don't forget to free the DATA_PTR inside the 1st node of the linked list
-      free(alloc->d.region_linked_list.data_ptr);
+      memory_region_data_free(alloc->d.region_linked_list.data_ptr, alloc->d.region_linked_list.capacity, alloc->d.region_linked_list.page_flags);
       
       break;
     }
 
     case MEMORY_ALLOCATOR_REGION_REALLOC: {
-      free(alloc->d.region_realloc.data_ptr);
+      memory_region_data_free(alloc->d.region_realloc.data_ptr, alloc->d.region_realloc.capacity, alloc->d.region_realloc.page_flags);
       break;
     }
 
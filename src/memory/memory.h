@@ -2,6 +2,7 @@
 #define MEMORY_HEADER_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 struct memory_region_realloc {
   //because we cannot do pointer arithmetic for void* in C, we must use
@@ -11,6 +12,7 @@ struct memory_region_realloc {
   char *data_ptr; //the start of the allocated memory on heap
   size_t capacity;
   size_t current_size;
+  uint32_t page_flags; //non-zero if data_ptr was allocated with memory_pages_alloc
 };
 
 struct memory_region_linked_list {
@@ -21,6 +23,7 @@ struct memory_region_linked_list {
   char *data_ptr; //the start of the allocated memory on heap
   size_t capacity;
   size_t current_size;
+  uint32_t page_flags; //non-zero if data_ptr was allocated with memory_pages_alloc
   
   //when the next allocation cannot
   //fit in the current memory region, allocate a new one to hold the allocation
@@ -57,6 +60,11 @@ struct memory_allocator {
   } d;
 };
 
+//set the memory_page_flag bits (see pages.h) used by all allocators for regions that are
+//at least MEMORY_PAGES_HUGE_SIZE bytes. This lets large builds be backed by huge pages.
+//Smaller regions always use malloc. The default is MEMORY_PAGE_FLAG_NONE.
+void memory_set_default_page_flags(uint32_t flags);
+
 //allocate a new memory_region on the heap with the specified capacity.
 struct memory_allocator* memory_create(size_t capacity, enum memory_allocator_tag tag);
 
@@ -0,0 +1,185 @@
+//mmap, madvise, and MAP_ANONYMOUS are not part of C99, so we need to ask for them
+//before any system headers are included.
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include "pages.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/mman.h>
+  #define MEMORY_PAGES_HAS_MMAP 1
+#else
+  #define MEMORY_PAGES_HAS_MMAP 0
+#endif
+
+
+//round size up to the next multiple of the huge page size
+static size_t memory_pages_round_size(size_t size, uint32_t flags) {
+  if(flags == MEMORY_PAGE_FLAG_NONE) {
+    return size;
+  }
+  return (size + MEMORY_PAGES_HUGE_SIZE - 1) & ~((size_t) MEMORY_PAGES_HUGE_SIZE - 1);
+}
+
+#if MEMORY_PAGES_HAS_MMAP
+
+//mmap only guarantees alignment to the normal page size, but transparent huge pages
+//can only back memory that is aligned to the huge page size.
+//To get an aligned block, we map an extra huge page worth of memory, then unmap the
+//unaligned head and the leftover tail.
+static void* memory_pages_map_aligned(size_t size) {
+  size_t padded_size = size + MEMORY_PAGES_HUGE_SIZE;
+  char *raw = mmap(NULL, padded_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(raw == MAP_FAILED) {
+    return NULL;
+  }
+
+  uintptr_t raw_adr = (uintptr_t) raw;
+  uintptr_t aligned_adr = (raw_adr + MEMORY_PAGES_HUGE_SIZE - 1) & ~((uintptr_t) MEMORY_PAGES_HUGE_SIZE - 1);
+  size_t head = aligned_adr - raw_adr;
+  size_t tail = padded_size - head - size;
+
+  if(head != 0) {
+    munmap(raw, head);
+  }
+  if(tail != 0) {
+    munmap((char*) aligned_adr + size, tail);
+  }
+
+  return (void*) aligned_adr;
+}
+
+#endif
+
+
+void* memory_pages_alloc(size_t size, uint32_t flags) {
+  if(size == 0) {
+    return NULL;
+  }
+
+#if MEMORY_PAGES_HAS_MMAP
+  size = memory_pages_round_size(size, flags);
+  void *ptr;
+
+#ifdef MAP_HUGETLB
+  if(flags & MEMORY_PAGE_FLAG_HUGETLBFS) {
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(ptr != MAP_FAILED) {
+      return ptr;
+    }
+    //no huge pages are reserved in hugetlbfs, so try transparent huge pages instead.
+  }
+#endif
+
+  if(flags == MEMORY_PAGE_FLAG_NONE) {
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? NULL : ptr;
+  }
+
+  ptr = memory_pages_map_aligned(size);
+  if(ptr == NULL) {
+    return NULL;
+  }
+
+#ifdef MADV_HUGEPAGE
+  //this is only a hint, so we don't care if it fails
+  madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+
+  return ptr;
+
+#else
+  (void) flags;
+  return calloc(1, size);
+#endif
+}
+
+
+void memory_pages_free(void *ptr, size_t size, uint32_t flags) {
+  if(ptr == NULL) {
+    return;
+  }
+
+#if MEMORY_PAGES_HAS_MMAP
+  munmap(ptr, memory_pages_round_size(size, flags));
+#else
+  (void) size;
+  (void) flags;
+  free(ptr);
+#endif
+}
+
+
+void* memory_pages_realloc(void *ptr, size_t old_size, size_t new_size, uint32_t flags) {
+  if(ptr == NULL) {
+    return memory_pages_alloc(new_size, flags);
+  }
+
+  //the rounded up block may already be big enough
+  if(memory_pages_round_size(old_size, flags) >= new_size && flags != MEMORY_PAGE_FLAG_NONE) {
+    return ptr;
+  }
+
+  void *new_ptr = memory_pages_alloc(new_size, flags);
+  if(new_ptr == NULL) {
+    return NULL;
+  }
+
+  memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+  memory_pages_free(ptr, old_size, flags);
+  return new_ptr;
+}
+
+
+size_t memory_pages_huge_bytes(void *ptr, size_t size) {
+#if defined(__linux__)
+  if(ptr == NULL) {
+    return 0;
+  }
+
+  //the kernel only tells us how many huge pages back a mapping through /proc
+  FILE *smaps = fopen("/proc/self/smaps", "r");
+  if(smaps == NULL) {
+    return 0;
+  }
+
+  uintptr_t block_start = (uintptr_t) ptr;
+  uintptr_t block_end = block_start + size;
+
+  size_t huge_bytes = 0;
+  uint8_t inside_block = 0;
+  char line[256];
+
+  while(fgets(line, sizeof(line), smaps) != NULL) {
+    unsigned long start;
+    unsigned long end;
+    unsigned long kb;
+
+    //a new mapping starts with its address range ("start-end perms ...")
+    if(sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+      inside_block = start < block_end && end > block_start;
+      continue;
+    }
+
+    if(!inside_block) {
+      continue;
+    }
+
+    if(sscanf(line, "AnonHugePages: %lu kB", &kb) == 1
+    || sscanf(line, "Private_Hugetlb: %lu kB", &kb) == 1
+    || sscanf(line, "Shared_Hugetlb: %lu kB", &kb) == 1) {
+      huge_bytes += (size_t) kb * 1024;
+    }
+  }
+
+  fclose(smaps);
+  return huge_bytes;
+#else
+  (void) ptr;
+  (void) size;
+  return 0;
+#endif
+}
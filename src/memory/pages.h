@@ -0,0 +1,42 @@
+#ifndef MEMORY_PAGES_H
+#define MEMORY_PAGES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//the size of a huge page on most x86-64 and ARM64 systems. Allocations made with
+//any of the huge page flags are rounded up to a multiple of this size.
+#define MEMORY_PAGES_HUGE_SIZE (2 * 1024 * 1024)
+
+enum memory_page_flag {
+  MEMORY_PAGE_FLAG_NONE = 0,
+
+  //back the allocation with transparent huge pages. The block is aligned to
+  //MEMORY_PAGES_HUGE_SIZE and marked with MADV_HUGEPAGE. The OS is free to ignore this.
+  MEMORY_PAGE_FLAG_HUGE = 1,
+
+  //back the allocation with pages from hugetlbfs (MAP_HUGETLB). If there are no
+  //huge pages reserved, this falls back to MEMORY_PAGE_FLAG_HUGE.
+  MEMORY_PAGE_FLAG_HUGETLBFS = 2,
+};
+
+
+//allocate a block of zero-filled memory directly from the operating system.
+//On platforms without mmap, this falls back to calloc and the flags are ignored.
+//Returns NULL on failure.
+void* memory_pages_alloc(size_t size, uint32_t flags);
+
+//free a block returned by memory_pages_alloc. The size and flags MUST match the
+//values used when allocating the block.
+void memory_pages_free(void *ptr, size_t size, uint32_t flags);
+
+//grow or shrink a block returned by memory_pages_alloc, copying over its contents.
+//Returns the new block on success. On failure, NULL is returned and the old block is left untouched.
+void* memory_pages_realloc(void *ptr, size_t old_size, size_t new_size, uint32_t flags);
+
+//returns the number of bytes in the block that the OS actually backed with huge pages.
+//Only Linux reports this, all other platforms return 0.
+size_t memory_pages_huge_bytes(void *ptr, size_t size);
+
+
+#endif // MEMORY_PAGES_H
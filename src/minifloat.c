@@ -0,0 +1,299 @@
+#include "minifloat.h"
+#include <string.h>
+#include <math.h>
+
+//F16C is only used when the compiler is allowed to emit it (-mf16c or -march=native). 
+//Otherwise the conversions fall back to bit manipulation.
+#if defined(__F16C__)
+  #include <immintrin.h>
+  #define RYVM_MINIFLOAT_HAS_F16C 1
+#else
+  #define RYVM_MINIFLOAT_HAS_F16C 0
+#endif
+
+
+static uint32_t ryvm_minifloat_f32_bits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, 4);
+  return bits;
+}
+
+static float ryvm_minifloat_bits_f32(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, 4);
+  return value;
+}
+
+//shift mantissa right by shift bits, rounding to the nearest value with ties going to even
+static uint32_t ryvm_minifloat_round_shift(uint32_t mantissa, uint32_t shift) {
+  uint32_t half = 1u << (shift - 1);
+  uint32_t remainder = mantissa & ((1u << shift) - 1);
+  uint32_t res = mantissa >> shift;
+  if(remainder > half || (remainder == half && (res & 1))) {
+    res++;
+  }
+  return res;
+}
+
+
+uint16_t ryvm_minifloat_f32_to_f16(float value) {
+#if RYVM_MINIFLOAT_HAS_F16C
+  return _cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT);
+#else
+  uint32_t bits = ryvm_minifloat_f32_bits(value);
+  uint16_t sign = (bits >> 16) & 0x8000;
+  uint32_t exponent = (bits >> 23) & 0xFF;
+  uint32_t mantissa = bits & 0x7FFFFF;
+
+  //infinity or NaN. NaNs stay quiet NaNs.
+  if(exponent == 0xFF) {
+    return sign | 0x7C00 | (mantissa != 0 ? 0x200 | (mantissa >> 13) : 0);
+  }
+
+  int32_t half_exponent = (int32_t) exponent - 127 + 15;
+  if(half_exponent >= 31) {
+    return sign | 0x7C00; //too large, becomes infinity
+  }
+
+  //too small for a normal f16, so it becomes a subnormal (or 0)
+  if(half_exponent <= 0) {
+    if(half_exponent < -10) {
+      return sign;
+    }
+    //a rounding carry turns the largest subnormal into the smallest normal number, which has the correct bits
+    return sign | (uint16_t) ryvm_minifloat_round_shift(mantissa | 0x800000, 14 - half_exponent);
+  }
+
+  //a rounding carry out of the mantissa increments the exponent, and can correctly round up to infinity
+  return sign | (uint16_t) (((uint32_t) half_exponent << 10) + ryvm_minifloat_round_shift(mantissa, 13));
+#endif
+}
+
+float ryvm_minifloat_f16_to_f32(uint16_t value) {
+#if RYVM_MINIFLOAT_HAS_F16C
+  return _cvtsh_ss(value);
+#else
+  uint32_t sign = (uint32_t) (value & 0x8000) << 16;
+  uint32_t exponent = (value >> 10) & 0x1F;
+  uint32_t mantissa = value & 0x3FF;
+
+  if(exponent == 0x1F) {
+    return ryvm_minifloat_bits_f32(sign | 0x7F800000 | (mantissa << 13));
+  }
+  if(exponent == 0) {
+    //subnormals are mantissa * 2^-24, which is exact in a 32-bit float
+    float res = (float) mantissa * 5.9604644775390625e-8f;
+    return sign ? -res : res;
+  }
+  return ryvm_minifloat_bits_f32(sign | ((exponent + 112) << 23) | (mantissa << 13));
+#endif
+}
+
+
+uint16_t ryvm_minifloat_f32_to_bf16(float value) {
+  uint32_t bits = ryvm_minifloat_f32_bits(value);
+  //keep NaNs from rounding into infinity
+  if((bits & 0x7FFFFFFF) > 0x7F800000) {
+    return (uint16_t) ((bits >> 16) | 0x40);
+  }
+  return (uint16_t) ((bits + 0x7FFF + ((bits >> 16) & 1)) >> 16);
+}
+
+float ryvm_minifloat_bf16_to_f32(uint16_t value) {
+  return ryvm_minifloat_bits_f32((uint32_t) value << 16);
+}
+
+
+//every fp8 value as a 32-bit float, indexed by its bits
+static const float ryvm_minifloat_fp8_table[256] = {
+  0.0f, 0.001953125f, 0.00390625f, 0.005859375f, 0.0078125f, 0.009765625f, 0.01171875f, 0.013671875f,
+  0.015625f, 0.017578125f, 0.01953125f, 0.021484375f, 0.0234375f, 0.025390625f, 0.02734375f, 0.029296875f,
+  0.03125f, 0.03515625f, 0.0390625f, 0.04296875f, 0.046875f, 0.05078125f, 0.0546875f, 0.05859375f,
+  0.0625f, 0.0703125f, 0.078125f, 0.0859375f, 0.09375f, 0.1015625f, 0.109375f, 0.1171875f,
+  0.125f, 0.140625f, 0.15625f, 0.171875f, 0.1875f, 0.203125f, 0.21875f, 0.234375f,
+  0.25f, 0.28125f, 0.3125f, 0.34375f, 0.375f, 0.40625f, 0.4375f, 0.46875f,
+  0.5f, 0.5625f, 0.625f, 0.6875f, 0.75f, 0.8125f, 0.875f, 0.9375f,
+  1.0f, 1.125f, 1.25f, 1.375f, 1.5f, 1.625f, 1.75f, 1.875f,
+  2.0f, 2.25f, 2.5f, 2.75f, 3.0f, 3.25f, 3.5f, 3.75f,
+  4.0f, 4.5f, 5.0f, 5.5f, 6.0f, 6.5f, 7.0f, 7.5f,
+  8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f,
+  16.0f, 18.0f, 20.0f, 22.0f, 24.0f, 26.0f, 28.0f, 30.0f,
+  32.0f, 36.0f, 40.0f, 44.0f, 48.0f, 52.0f, 56.0f, 60.0f,
+  64.0f, 72.0f, 80.0f, 88.0f, 96.0f, 104.0f, 112.0f, 120.0f,
+  128.0f, 144.0f, 160.0f, 176.0f, 192.0f, 208.0f, 224.0f, 240.0f,
+  256.0f, 288.0f, 320.0f, 352.0f, 384.0f, 416.0f, 448.0f, NAN,
+  -0.0f, -0.001953125f, -0.00390625f, -0.005859375f, -0.0078125f, -0.009765625f, -0.01171875f, -0.013671875f,
+  -0.015625f, -0.017578125f, -0.01953125f, -0.021484375f, -0.0234375f, -0.025390625f, -0.02734375f, -0.029296875f,
+  -0.03125f, -0.03515625f, -0.0390625f, -0.04296875f, -0.046875f, -0.05078125f, -0.0546875f, -0.05859375f,
+  -0.0625f, -0.0703125f, -0.078125f, -0.0859375f, -0.09375f, -0.1015625f, -0.109375f, -0.1171875f,
+  -0.125f, -0.140625f, -0.15625f, -0.171875f, -0.1875f, -0.203125f, -0.21875f, -0.234375f,
+  -0.25f, -0.28125f, -0.3125f, -0.34375f, -0.375f, -0.40625f, -0.4375f, -0.46875f,
+  -0.5f, -0.5625f, -0.625f, -0.6875f, -0.75f, -0.8125f, -0.875f, -0.9375f,
+  -1.0f, -1.125f, -1.25f, -1.375f, -1.5f, -1.625f, -1.75f, -1.875f,
+  -2.0f, -2.25f, -2.5f, -2.75f, -3.0f, -3.25f, -3.5f, -3.75f,
+  -4.0f, -4.5f, -5.0f, -5.5f, -6.0f, -6.5f, -7.0f, -7.5f,
+  -8.0f, -9.0f, -10.0f, -11.0f, -12.0f, -13.0f, -14.0f, -15.0f,
+  -16.0f, -18.0f, -20.0f, -22.0f, -24.0f, -26.0f, -28.0f, -30.0f,
+  -32.0f, -36.0f, -40.0f, -44.0f, -48.0f, -52.0f, -56.0f, -60.0f,
+  -64.0f, -72.0f, -80.0f, -88.0f, -96.0f, -104.0f, -112.0f, -120.0f,
+  -128.0f, -144.0f, -160.0f, -176.0f, -192.0f, -208.0f, -224.0f, -240.0f,
+  -256.0f, -288.0f, -320.0f, -352.0f, -384.0f, -416.0f, -448.0f, -NAN,
+};
+
+uint8_t ryvm_minifloat_f32_to_fp8(float value) {
+  uint32_t bits = ryvm_minifloat_f32_bits(value);
+  uint8_t sign = (bits >> 24) & 0x80;
+  uint32_t abs_bits = bits & 0x7FFFFFFF;
+
+  if(abs_bits > 0x7F800000) {
+    return sign | 0x7F; //NaN
+  }
+  //448 is the largest fp8 number, and the format has no infinity
+  if(ryvm_minifloat_bits_f32(abs_bits) >= 448.0f) {
+    return sign | 0x7E;
+  }
+
+  int32_t exponent = (int32_t) (abs_bits >> 23) - 127 + 7;
+  uint32_t mantissa = abs_bits & 0x7FFFFF;
+
+  if(exponent <= 0) {
+    if(exponent < -3) {
+      return sign;
+    }
+    return sign | (uint8_t) ryvm_minifloat_round_shift(mantissa | 0x800000, 21 - exponent);
+  }
+
+  uint32_t res = ((uint32_t) exponent << 3) + ryvm_minifloat_round_shift(mantissa, 20);
+  //rounding up from just below 448 must not produce the NaN encoding
+  return sign | (uint8_t) (res > 0x7E ? 0x7E : res);
+}
+
+float ryvm_minifloat_fp8_to_f32(uint8_t value) {
+  return ryvm_minifloat_fp8_table[value];
+}
+
+
+uint8_t ryvm_minifloat_format_bytewidth(enum ryvm_float_format format) {
+  switch(format) {
+    case RYVM_FLOAT_FORMAT_F64: return 8;
+    case RYVM_FLOAT_FORMAT_F32: return 4;
+    case RYVM_FLOAT_FORMAT_F16: return 2;
+    case RYVM_FLOAT_FORMAT_BF16: return 2;
+    case RYVM_FLOAT_FORMAT_FP8: return 1;
+    default: return 0;
+  }
+}
+
+
+//arrays are converted in chunks through a buffer of 32-bit floats, 
+//so each format only needs 1 loop to read it and 1 loop to write it.
+#define RYVM_MINIFLOAT_CHUNK 256
+
+static void ryvm_minifloat_read_chunk(float *dest, const uint8_t *src, enum ryvm_float_format format, uint64_t count) {
+  uint64_t i = 0;
+  switch(format) {
+    case RYVM_FLOAT_FORMAT_F64:
+      for(; i < count; i++) {
+        double d;
+        memcpy(&d, src + i * 8, 8);
+        dest[i] = (float) d;
+      }
+      break;
+    case RYVM_FLOAT_FORMAT_F32:
+      memcpy(dest, src, count * 4);
+      break;
+    case RYVM_FLOAT_FORMAT_F16:
+#if RYVM_MINIFLOAT_HAS_F16C
+      for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dest + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (src + i * 2))));
+      }
+#endif
+      for(; i < count; i++) {
+        uint16_t h;
+        memcpy(&h, src + i * 2, 2);
+        dest[i] = ryvm_minifloat_f16_to_f32(h);
+      }
+      break;
+    case RYVM_FLOAT_FORMAT_BF16:
+      for(; i < count; i++) {
+        uint16_t h;
+        memcpy(&h, src + i * 2, 2);
+        dest[i] = ryvm_minifloat_bf16_to_f32(h);
+      }
+      break;
+    case RYVM_FLOAT_FORMAT_FP8:
+      for(; i < count; i++) {
+        dest[i] = ryvm_minifloat_fp8_table[src[i]];
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static void ryvm_minifloat_write_chunk(uint8_t *dest, const float *src, enum ryvm_float_format format, uint64_t count) {
+  uint64_t i = 0;
+  switch(format) {
+    case RYVM_FLOAT_FORMAT_F64:
+      for(; i < count; i++) {
+        double d = src[i];
+        memcpy(dest + i * 8, &d, 8);
+      }
+      break;
+    case RYVM_FLOAT_FORMAT_F32:
+      memcpy(dest, src, count * 4);
+      break;
+    case RYVM_FLOAT_FORMAT_F16:
+#if RYVM_MINIFLOAT_HAS_F16C
+      for(; i + 8 <= count; i += 8) {
+        _mm_storeu_si128((__m128i*) (dest + i * 2), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+      }
+#endif
+      for(; i < count; i++) {
+        uint16_t h = ryvm_minifloat_f32_to_f16(src[i]);
+        memcpy(dest + i * 2, &h, 2);
+      }
+      break;
+    case RYVM_FLOAT_FORMAT_BF16:
+      for(; i < count; i++) {
+        uint16_t h = ryvm_minifloat_f32_to_bf16(src[i]);
+        memcpy(dest + i * 2, &h, 2);
+      }
+      break;
+    case RYVM_FLOAT_FORMAT_FP8:
+      for(; i < count; i++) {
+        dest[i] = ryvm_minifloat_f32_to_fp8(src[i]);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+int ryvm_minifloat_convert_array(void *dest, enum ryvm_float_format dest_format, const void *src, enum ryvm_float_format src_format, uint64_t count) {
+  if(dest_format >= RYVM_FLOAT_FORMAT_COUNT || src_format >= RYVM_FLOAT_FORMAT_COUNT) {
+    return 0;
+  }
+
+  if(dest_format == src_format) {
+    memmove(dest, src, count * ryvm_minifloat_format_bytewidth(src_format));
+    return 1;
+  }
+
+  uint8_t src_bytewidth = ryvm_minifloat_format_bytewidth(src_format);
+  uint8_t dest_bytewidth = ryvm_minifloat_format_bytewidth(dest_format);
+  const uint8_t *in = src;
+  uint8_t *out = dest;
+  float chunk[RYVM_MINIFLOAT_CHUNK];
+
+  while(count > 0) {
+    uint64_t n = count < RYVM_MINIFLOAT_CHUNK ? count : RYVM_MINIFLOAT_CHUNK;
+    ryvm_minifloat_read_chunk(chunk, in, src_format, n);
+    ryvm_minifloat_write_chunk(out, chunk, dest_format, n);
+    in += n * src_bytewidth;
+    out += n * dest_bytewidth;
+    count -= n;
+  }
+
+  return 1;
+}
@@ -0,0 +1,42 @@
+#ifndef RYVM_MINIFLOAT_H
+#define RYVM_MINIFLOAT_H
+
+#include <stdint.h>
+
+//Floating point formats smaller than 32 bits. These are converted to and from 32-bit floats,
+//which is what all arithmetic on them is done with.
+//  - f16: IEEE 754 half precision. 1 sign bit, 5 exponent bits, 10 mantissa bits.
+//  - bf16: bfloat16, the upper half of a 32-bit float. 1 sign bit, 8 exponent bits, 7 mantissa bits.
+//  - fp8: the OCP FP8 E4M3 format. 1 sign bit, 4 exponent bits, 3 mantissa bits. 
+//    There is no infinity, the largest value is 448, and values that are too large saturate to 448.
+//All conversions to a smaller format round to the nearest value, with ties going to the even value.
+
+enum ryvm_float_format {
+  RYVM_FLOAT_FORMAT_F64 = 0,
+  RYVM_FLOAT_FORMAT_F32 = 1,
+  RYVM_FLOAT_FORMAT_F16 = 2,
+  RYVM_FLOAT_FORMAT_BF16 = 3,
+  RYVM_FLOAT_FORMAT_FP8 = 4,
+
+  RYVM_FLOAT_FORMAT_COUNT
+};
+
+uint16_t ryvm_minifloat_f32_to_f16(float value);
+float ryvm_minifloat_f16_to_f32(uint16_t value);
+
+uint16_t ryvm_minifloat_f32_to_bf16(float value);
+float ryvm_minifloat_bf16_to_f32(uint16_t value);
+
+uint8_t ryvm_minifloat_f32_to_fp8(float value);
+float ryvm_minifloat_fp8_to_f32(uint8_t value);
+
+//returns the size of a single number in the format
+uint8_t ryvm_minifloat_format_bytewidth(enum ryvm_float_format format);
+
+//convert count numbers from src_format to dest_format. dest and src must not overlap unless the formats are identical.
+//Converting from f64 to any smaller format rounds to f32 first.
+//Returns 0 if either format is invalid, otherwise returns 1.
+int ryvm_minifloat_convert_array(void *dest, enum ryvm_float_format dest_format, const void *src, enum ryvm_float_format src_format, uint64_t count);
+
+
+#endif // RYVM_MINIFLOAT_H
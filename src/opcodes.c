@@ -50,12 +50,76 @@
 #define RYVM_OP_STR_BLE BLE
 #define RYVM_OP_STR_BGE BGE
 #define RYVM_OP_STR_B B
-#define RYVM_OP_STR_BZ BZ
-#define RYVM_OP_STR_BNZ BNZ
 #define RYVM_OP_STR_BR BR
 #define RYVM_OP_STR_BL BL
 #define RYVM_OP_STR_BLR BLR
 #define RYVM_OP_STR_SYS SYS
+#define RYVM_OP_STR_CAS CAS
+#define RYVM_OP_STR_LDADD LDADD
+#define RYVM_OP_STR_LDAR LDAR
+#define RYVM_OP_STR_STLR STLR
+#define RYVM_OP_STR_FENCE FENCE
+#define RYVM_OP_STR_VLD VLD
+#define RYVM_OP_STR_VST VST
+#define RYVM_OP_STR_VADD VADD
+#define RYVM_OP_STR_VSUB VSUB
+#define RYVM_OP_STR_VMUL VMUL
+#define RYVM_OP_STR_VADDF VADDF
+#define RYVM_OP_STR_VSUBF VSUBF
+#define RYVM_OP_STR_VMULF VMULF
+#define RYVM_OP_STR_VCMPEQ VCMPEQ
+#define RYVM_OP_STR_VCMPGT VCMPGT
+#define RYVM_OP_STR_VRADD VRADD
+#define RYVM_OP_STR_VRADDF VRADDF
+#define RYVM_OP_STR_VDUP VDUP
+#define RYVM_OP_STR_VMSK VMSK
+#define RYVM_OP_STR_POPCNT POPCNT
+#define RYVM_OP_STR_CLZ CLZ
+#define RYVM_OP_STR_CTZ CTZ
+#define RYVM_OP_STR_ROL ROL
+#define RYVM_OP_STR_ROR ROR
+#define RYVM_OP_STR_BSWAP BSWAP
+#define RYVM_OP_STR_MULH MULH
+#define RYVM_OP_STR_MULHU MULHU
+#define RYVM_OP_STR_FMA FMA
+#define RYVM_OP_STR_FSQRT FSQRT
+#define RYVM_OP_STR_FMIN FMIN
+#define RYVM_OP_STR_FMAX FMAX
+#define RYVM_OP_STR_FABS FABS
+#define RYVM_OP_STR_FNEG FNEG
+#define RYVM_OP_STR_FRND FRND
+#define RYVM_OP_STR_FXMUL FXMUL
+#define RYVM_OP_STR_FXDIV FXDIV
+#define RYVM_OP_STR_FCVT FCVT
+#define RYVM_OP_STR_STM STM
+#define RYVM_OP_STR_LDM LDM
+#define RYVM_OP_STR_CBZ CBZ
+#define RYVM_OP_STR_CBNZ CBNZ
+#define RYVM_OP_STR_CBEQ CBEQ
+#define RYVM_OP_STR_CBNE CBNE
+#define RYVM_OP_STR_CBLT CBLT
+#define RYVM_OP_STR_CBGE CBGE
+#define RYVM_OP_STR_CBLTU CBLTU
+#define RYVM_OP_STR_CBGEU CBGEU
+#define RYVM_OP_STR_CSEL CSEL
+#define RYVM_OP_STR_CSINC CSINC
+#define RYVM_OP_STR_LOOP LOOP
+#define RYVM_OP_STR_LDX LDX
+#define RYVM_OP_STR_STX STX
+#define RYVM_OP_STR_LDPOST LDPOST
+#define RYVM_OP_STR_STPOST STPOST
+#define RYVM_OP_STR_LDPRE LDPRE
+#define RYVM_OP_STR_STPRE STPRE
+#define RYVM_OP_STR_LDI32 LDI32
+#define RYVM_OP_STR_LDI64 LDI64
+#define RYVM_OP_STR_ADDI32 ADDI32
+#define RYVM_OP_STR_SUBI32 SUBI32
+#define RYVM_OP_STR_ANDI32 ANDI32
+#define RYVM_OP_STR_ORI32 ORI32
+#define RYVM_OP_STR_XORI32 XORI32
+#define RYVM_OP_STR_CALLW CALLW
+#define RYVM_OP_STR_RETW RETW
+#define RYVM_OP_STR_TCALLW TCALLW
 
 
 
@@ -68,8 +132,8 @@ int ryvm_opcode_str_to_op(const char *s, enum ryvm_opcode *code) {
   RYVM_OPCODE_STR(s, RYVM_OP_STR_PCR, res)
   RYVM_OPCODE_STR(s, RYVM_OP_STR_LDI, res)
   RYVM_OPCODE_STR(s, RYVM_OP_STR_STR, res)
-  RYVM_OPCODE_STR(s, RYVM_OP_STR_LDI, res)
-  RYVM_OPCODE_STR(s, RYVM_OP_STR_STR, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FXFP, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FPFX, res)
   RYVM_OPCODE_STR(s, RYVM_OP_STR_ADDI, res)
   RYVM_OPCODE_STR(s, RYVM_OP_STR_SUBI, res)
   RYVM_OPCODE_STR(s, RYVM_OP_STR_ADD, res)
@@ -108,6 +172,72 @@ int ryvm_opcode_str_to_op(const char *s, enum ryvm_opcode *code) {
   RYVM_OPCODE_STR(s, RYVM_OP_STR_BL, res)
   RYVM_OPCODE_STR(s, RYVM_OP_STR_BLR, res)
   RYVM_OPCODE_STR(s, RYVM_OP_STR_SYS, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CAS, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_LDADD, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_LDAR, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_STLR, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FENCE, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VLD, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VST, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VADD, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VSUB, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VMUL, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VADDF, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VSUBF, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VMULF, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VCMPEQ, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VCMPGT, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VRADD, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VRADDF, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VDUP, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_VMSK, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_POPCNT, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CLZ, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CTZ, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_ROL, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_ROR, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_BSWAP, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_MULH, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_MULHU, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FMA, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FSQRT, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FMIN, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FMAX, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FABS, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FNEG, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FRND, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FXMUL, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FXDIV, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_FCVT, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_STM, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_LDM, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CBZ, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CBNZ, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CBEQ, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CBNE, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CBLT, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CBGE, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CBLTU, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CBGEU, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CSEL, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CSINC, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_LOOP, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_LDX, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_STX, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_LDPOST, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_STPOST, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_LDPRE, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_STPRE, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_LDI32, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_LDI64, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_ADDI32, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_SUBI32, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_ANDI32, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_ORI32, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_XORI32, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_CALLW, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_RETW, res)
+  RYVM_OPCODE_STR(s, RYVM_OP_STR_TCALLW, res)
 
 
   return 0;
@@ -163,6 +293,72 @@ const char * ryvm_opcode_op_to_str(enum ryvm_opcode op) {
     RYVM_OPCODE_STR_REP(RYVM_OP_STR_BL)
     RYVM_OPCODE_STR_REP(RYVM_OP_STR_BLR)
     RYVM_OPCODE_STR_REP(RYVM_OP_STR_SYS)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CAS)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_LDADD)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_LDAR)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_STLR)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_FENCE)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VLD)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VST)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VADD)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VSUB)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VMUL)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VADDF)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VSUBF)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VMULF)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VCMPEQ)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VCMPGT)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VRADD)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VRADDF)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VDUP)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_VMSK)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_POPCNT)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CLZ)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CTZ)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_ROL)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_ROR)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_BSWAP)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_MULH)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_MULHU)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_FMA)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_FSQRT)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_FMIN)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_FMAX)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_FABS)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_FNEG)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_FRND)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_FXMUL)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_FXDIV)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_FCVT)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_STM)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_LDM)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CBZ)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CBNZ)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CBEQ)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CBNE)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CBLT)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CBGE)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CBLTU)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CBGEU)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CSEL)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CSINC)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_LOOP)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_LDX)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_STX)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_LDPOST)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_STPOST)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_LDPRE)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_STPRE)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_LDI32)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_LDI64)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_ADDI32)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_SUBI32)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_ANDI32)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_ORI32)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_XORI32)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_CALLW)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_RETW)
+    RYVM_OPCODE_STR_REP(RYVM_OP_STR_TCALLW)
     default: assert(0);
   }
   return NULL;
@@ -218,8 +414,91 @@ enum ryvm_ins_format ryvm_opcode_get_ins_format(enum ryvm_opcode op) {
     RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_BL,   RYVM_INS_FORMAT_R1)
     RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_BLR,  RYVM_INS_FORMAT_R2)
     RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_SYS,  RYVM_INS_FORMAT_R0)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CAS,   RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_LDADD, RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_LDAR,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_STLR,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_FENCE, RYVM_INS_FORMAT_R0)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VLD,   RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VST,   RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VADD,  RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VSUB,  RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VMUL,  RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VADDF, RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VSUBF, RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VMULF, RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VCMPEQ, RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VCMPGT, RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VRADD, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VRADDF, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VDUP,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_VMSK,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_POPCNT, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CLZ,   RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CTZ,   RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_ROL,   RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_ROR,   RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_BSWAP, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_MULH,  RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_MULHU, RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_FMA,   RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_FSQRT, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_FMIN,  RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_FMAX,  RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_FABS,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_FNEG,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_FRND,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_FXMUL, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_FXDIV, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_FCVT,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_STM,   RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_LDM,   RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CBZ,   RYVM_INS_FORMAT_R1)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CBNZ,  RYVM_INS_FORMAT_R1)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CBEQ,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CBNE,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CBLT,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CBGE,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CBLTU, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CBGEU, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CSEL,  RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CSINC, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_LOOP,  RYVM_INS_FORMAT_R1)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_LDX,   RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_STX,   RYVM_INS_FORMAT_R3)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_LDPOST, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_STPOST, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_LDPRE, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_STPRE, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_LDI32, RYVM_INS_FORMAT_R1)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_LDI64, RYVM_INS_FORMAT_R1)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_ADDI32, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_SUBI32, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_ANDI32, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_ORI32, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_XORI32, RYVM_INS_FORMAT_R2)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_CALLW, RYVM_INS_FORMAT_R1)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_RETW,  RYVM_INS_FORMAT_R1)
+    RYVM_MACRO_OPCODE_FORMAT(RYVM_OP_STR_TCALLW, RYVM_INS_FORMAT_R0)
     default: assert(0);
   }
   return -1;
 }
 
+uint8_t ryvm_opcode_ext_size(enum ryvm_opcode op) {
+  switch(op) {
+    case RYVM_OP_LDI64: return 8;
+    case RYVM_OP_LDI32:
+    case RYVM_OP_ADDI32:
+    case RYVM_OP_SUBI32:
+    case RYVM_OP_ANDI32:
+    case RYVM_OP_ORI32:
+    case RYVM_OP_XORI32: return 4;
+    default: return 0;
+  }
+}
+
+int ryvm_opcode_is_jump(enum ryvm_opcode op) {
+  return (op >= RYVM_OP_B && op <= RYVM_OP_BLR) || (op >= RYVM_OP_CBZ && op <= RYVM_OP_CBGEU)
+    || op == RYVM_OP_LOOP || op == RYVM_OP_CALLW || op == RYVM_OP_RETW || op == RYVM_OP_TCALLW;
+}
@@ -10,8 +10,8 @@ enum ryvm_opcode {
   RYVM_OP_PCR,     // PCR W0, #1             ; Get PC-relative address using a 2-byte signed offset and store it in W0
   RYVM_OP_LDI,     // LDI W0, #1             ; load 2-byte immediate value that's sign-extended to the specified byte-width. Can only be integers.
   RYVM_OP_STR,     // STR E0, W1, #off       ; Store E0 into address stored at W1 + off
-  RYVM_OP_FXFP,    // FXFP W0 W1 #fixed_prec ; W0 = (float) W1; where #fixed_prec[0] determines if W1 is signed or unsigned, and #fixed_prec[1:7] is the 7-bit number representing the number of fractional bits in W1 
-  RYVM_OP_FPFX,    // FPFX W0 W1 #fixed_prec ; W0 = #fixed_prec & 0b10000000 == 0 ? (unsigned int) W1 : int(W1); where #fixed_prec[0] determines if W0 is signed or unsigned, and #fixed_prec[1:7] is the 7-bit number representing the number of fractional bits in W0 
+  RYVM_OP_FXFP,    // FXFP W0 W1 #fixed_prec ; W0 = (float) W1 / 2^(#fixed_prec & 127); where bit 7 of #fixed_prec is set if W1 is signed, and the lower 7 bits are the number of fractional bits in W1
+  RYVM_OP_FPFX,    // FPFX W0 W1 #fixed_prec ; W0 = W1 * 2^(#fixed_prec & 127), rounded to the nearest integer and saturated; where bit 7 of #fixed_prec is set if W0 is signed, and the lower 7 bits are the number of fractional bits in W0
   RYVM_OP_ADDI,    // ADDI W0 W1 #imm        ; W0 = W1 + imm ; imm is signed 8 bits
   RYVM_OP_SUBI,    // SUBI W0 W1 #imm        ; W0 = W1 - imm; imm is signed 8 bits
   RYVM_OP_ADD ,    // ADD E0, E1, E2         ; Add 8bit 2-s complement integers and store it in E0
@@ -49,7 +49,75 @@ enum ryvm_opcode {
   RYVM_OP_BR,      // BR W0, #imm            ; pc = W0 + #imm;  indirect jump without saving link register. can be useful for return statement or for executing a specific function within an array of function pointers.
   RYVM_OP_BL ,     // BL W0, #imm            ; branch and link; W0 = pc + 4; pc = pc + imm  ; imm is signed 16bit offset
   RYVM_OP_BLR ,    // BLR W0, W1, #imm       ; W0 = pc + 4;   pc = W1 + imm ; imm is signed 8bits (used for indirect jumps, calls, and returns)
-  RYVM_OP_SYS      // SYS #imm               ; a external function call to call OS-specific functions in a cross-platform way, using a 24bit syscall number 
+  RYVM_OP_SYS,     // SYS #imm               ; a external function call to call OS-specific functions in a cross-platform way, using a 24bit syscall number 
+  RYVM_OP_CAS,     // CAS W0 W1 W2           ; atomic compare-and-swap at address W2: if [W2] == W0, [W2] = W1. W0 = old value of [W2]. Bytewidth comes from W0
+  RYVM_OP_LDADD,   // LDADD W0 W1 W2         ; atomic fetch-and-add at address W2: W0 = [W2]; [W2] += W1. Bytewidth comes from W0
+  RYVM_OP_LDAR,    // LDAR W0 W1 #imm        ; load-acquire from address (W1 + imm) into W0. imm is signed 8 bits
+  RYVM_OP_STLR,    // STLR W0 W1 #imm        ; store-release W0 into address (W1 + imm). imm is signed 8 bits
+  RYVM_OP_FENCE,   // FENCE #imm             ; full memory barrier; imm is ignored and should be 0
+  RYVM_OP_VLD,     // VLD W0 W1 #imm         ; load 32 bytes from address (W1 + imm) into vector register V0. imm is signed 8 bits
+  RYVM_OP_VST,     // VST W0 W1 #imm         ; store vector register V0 into 32 bytes at address (W1 + imm). imm is signed 8 bits
+  RYVM_OP_VADD,    // VADD H0 H1 H2          ; V0 = V1 + V2 for each integer lane. Lane width comes from the sigil of the destination (H = 8 lanes of 32 bits)
+  RYVM_OP_VSUB,    // VSUB H0 H1 H2          ; V0 = V1 - V2 for each integer lane
+  RYVM_OP_VMUL,    // VMUL H0 H1 H2          ; V0 = V1 * V2 for each integer lane, keeping the low bits of each product
+  RYVM_OP_VADDF,   // VADDF W0 W1 W2         ; V0 = V1 + V2 for each float lane. H = 8 lanes of 32-bit floats, W = 4 lanes of 64-bit floats
+  RYVM_OP_VSUBF,   // VSUBF W0 W1 W2         ; V0 = V1 - V2 for each float lane
+  RYVM_OP_VMULF,   // VMULF W0 W1 W2         ; V0 = V1 * V2 for each float lane
+  RYVM_OP_VCMPEQ,  // VCMPEQ E0 E1 E2        ; each lane of V0 is set to all 1s if the lanes of V1 and V2 are equal, otherwise 0
+  RYVM_OP_VCMPGT,  // VCMPGT E0 E1 E2        ; each lane of V0 is set to all 1s if the lane of V1 > V2 (signed), otherwise 0
+  RYVM_OP_VRADD,   // VRADD W0 H1 #imm       ; W0 = sum of every integer lane in V1. Lane width comes from the sigil of V1. imm is ignored and should be 0
+  RYVM_OP_VRADDF,  // VRADDF W0 W1 #imm      ; W0 = sum of every float lane in V1. The sum has the same bytewidth as the lanes. imm is ignored and should be 0
+  RYVM_OP_VDUP,    // VDUP E0 W1 #imm        ; copy the lowest bytes of W1 into every lane of V0. Lane width comes from the sigil of V0. imm is ignored and should be 0
+  RYVM_OP_VMSK,    // VMSK W0 E1 #imm        ; W0 = bitmask of the most significant bit of each lane of V1. Lane width comes from the sigil of V1. imm is ignored and should be 0
+  RYVM_OP_POPCNT,  // POPCNT W0 W1 #imm      ; W0 = number of bits set in W1. imm is ignored and should be 0
+  RYVM_OP_CLZ,     // CLZ W0 W1 #imm         ; W0 = number of leading zero bits in W1, counted within the bytewidth of W1. imm is ignored and should be 0
+  RYVM_OP_CTZ,     // CTZ W0 W1 #imm         ; W0 = number of trailing zero bits in W1. If W1 is 0, this is the number of bits in W1. imm is ignored and should be 0
+  RYVM_OP_ROL,     // ROL W0 W1 W2           ; rotate W1 left by W2 bits within the bytewidth of W0, and store it in W0
+  RYVM_OP_ROR,     // ROR W0 W1 W2           ; rotate W1 right by W2 bits within the bytewidth of W0, and store it in W0
+  RYVM_OP_BSWAP,   // BSWAP W0 W1 #imm       ; reverse the order of the bytes in W1, within the bytewidth of W0. imm is ignored and should be 0
+  RYVM_OP_MULH,    // MULH W0 W1 W2          ; multiply 2 signed integers, keeping the upper half of the double-width product (W0 = (W1 * W2) >> 64)
+  RYVM_OP_MULHU,   // MULHU W0 W1 W2         ; multiply 2 unsigned integers, keeping the upper half of the double-width product
+  RYVM_OP_FMA,     // FMA W0 W1 W2           ; fused multiply-add: W0 = W1 * W2 + W0, rounded once. W registers hold 64-bit floats, all others hold 32-bit floats
+  RYVM_OP_FSQRT,   // FSQRT W0 W1 #imm       ; W0 = square root of W1. imm is ignored and should be 0
+  RYVM_OP_FMIN,    // FMIN W0 W1 W2          ; W0 = the smaller of W1 and W2. If only one of them is NaN, the other one is picked
+  RYVM_OP_FMAX,    // FMAX W0 W1 W2          ; W0 = the larger of W1 and W2. If only one of them is NaN, the other one is picked
+  RYVM_OP_FABS,    // FABS W0 W1 #imm        ; W0 = absolute value of W1. imm is ignored and should be 0
+  RYVM_OP_FNEG,    // FNEG W0 W1 #imm        ; W0 = -W1. imm is ignored and should be 0
+  RYVM_OP_FRND,    // FRND W0 W1 #imm        ; round W1 to an integral float and store it in W0. imm selects the mode: 0 = nearest (ties away from 0), 1 = floor, 2 = ceiling, 3 = truncate
+  RYVM_OP_FXMUL,   // FXMUL W0 W1 #imm       ; fixed point multiply: W0 = (W0 * W1) >> (imm & 63), saturated to the range of W0. Bit 7 of imm is set for signed numbers, bit 6 rounds to nearest instead of truncating
+  RYVM_OP_FXDIV,   // FXDIV W0 W1 #imm       ; fixed point divide: W0 = (W0 << (imm & 63)) / W1, saturated to the range of W0. Bit 7 of imm is set for signed numbers, bit 6 rounds to nearest instead of truncating
+  RYVM_OP_FCVT,    // FCVT Q0 W1 #imm        ; convert the float in W1 to the float format of W0 (W = f64, H = f32, Q = f16, E = FP8). If bit 0 of imm is set, a Q destination is bfloat16 instead of f16. Bit 1 does the same for the source
+  RYVM_OP_STM,     // STM W0 W5 SP           ; push W0 through W5 onto the stack: store them at the address in SP (lowest register first), then SP += 6 * 8. The sigil of the 1st register sets the bytewidth of each register
+  RYVM_OP_LDM,     // LDM W0 W5 SP           ; pop W0 through W5 from the stack: SP -= 6 * 8, then load them from the address in SP. Undoes a STM with the same registers
+  RYVM_OP_CBZ,     // CBZ W0 #imm            ; if W0 == 0, jump to the PC-relative offset imm. imm is signed 16 bits. Does not change the SF register
+  RYVM_OP_CBNZ,    // CBNZ W0 #imm           ; if W0 != 0, jump to the PC-relative offset imm. imm is signed 16 bits. Does not change the SF register
+  RYVM_OP_CBEQ,    // CBEQ W0 W1 #imm        ; if W0 == W1, jump to the PC-relative offset imm. imm is signed 8 bits. Does not change the SF register
+  RYVM_OP_CBNE,    // CBNE W0 W1 #imm        ; if W0 != W1, jump to the PC-relative offset imm. imm is signed 8 bits
+  RYVM_OP_CBLT,    // CBLT W0 W1 #imm        ; if W0 < W1 (signed), jump to the PC-relative offset imm. imm is signed 8 bits
+  RYVM_OP_CBGE,    // CBGE W0 W1 #imm        ; if W0 >= W1 (signed), jump to the PC-relative offset imm. imm is signed 8 bits
+  RYVM_OP_CBLTU,   // CBLTU W0 W1 #imm       ; if W0 < W1 (unsigned), jump to the PC-relative offset imm. imm is signed 8 bits
+  RYVM_OP_CBGEU,   // CBGEU W0 W1 #imm       ; if W0 >= W1 (unsigned), jump to the PC-relative offset imm. imm is signed 8 bits
+  RYVM_OP_CSEL,    // CSEL W0 W1 #imm        ; W0 = cond ? W1 : W0, where the condition code imm is tested against the SF register (see Conditional Select below)
+  RYVM_OP_CSINC,   // CSINC W0 W1 #imm       ; W0 = cond ? W1 : W0 + 1, where the condition code imm is tested against the SF register
+  RYVM_OP_LOOP,    // LOOP W0 #imm           ; W0 = W0 - 1, then if W0 != 0, jump to the PC-relative offset imm. imm is signed 16 bits. Does not change the SF register
+  RYVM_OP_LDX,     // LDX W0 W1 W2           ; Load from address (W1 + W2 * bytewidth of W0) into W0. W2 is sign extended from its own bytewidth, so it is an element index
+  RYVM_OP_STX,     // STX W0 W1 W2           ; Store W0 into address (W1 + W2 * bytewidth of W0). W2 is sign extended from its own bytewidth
+  RYVM_OP_LDPOST,  // LDPOST W0 W1 #imm      ; Load from address W1 into W0, then W1 += imm. imm is signed 8 bits
+  RYVM_OP_STPOST,  // STPOST W0 W1 #imm      ; Store W0 into address W1, then W1 += imm. imm is signed 8 bits
+  RYVM_OP_LDPRE,   // LDPRE W0 W1 #imm       ; W1 += imm, then load from address W1 into W0. imm is signed 8 bits
+  RYVM_OP_STPRE,   // STPRE W0 W1 #imm       ; W1 += imm, then store W0 into address W1. imm is signed 8 bits
+  RYVM_OP_LDI32,   // LDI32 W0 #imm          ; load a signed 32-bit immediate stored in the extension word after this instruction (8 bytes total)
+  RYVM_OP_LDI64,   // LDI64 W0 #imm          ; load a 64-bit immediate stored in the 2 extension words after this instruction (12 bytes total)
+  RYVM_OP_ADDI32,  // ADDI32 W0 W1 #imm      ; W0 = W1 + imm, where imm is a signed 32-bit extension word
+  RYVM_OP_SUBI32,  // SUBI32 W0 W1 #imm      ; W0 = W1 - imm, where imm is a signed 32-bit extension word
+  RYVM_OP_ANDI32,  // ANDI32 W0 W1 #imm      ; W0 = W1 & imm, where imm is a signed 32-bit extension word
+  RYVM_OP_ORI32,   // ORI32 W0 W1 #imm       ; W0 = W1 | imm, where imm is a signed 32-bit extension word
+  RYVM_OP_XORI32,  // XORI32 W0 W1 #imm      ; W0 = W1 ^ imm, where imm is a signed 32-bit extension word
+  RYVM_OP_CALLW,   // CALLW W0 #imm          ; push the callee-saved registers W20-W39, LR and FP, set FP = SP, then W0 = PC and jump to the PC-relative offset imm. imm is signed 16 bits
+  RYVM_OP_RETW,    // RETW W0 #imm           ; jump to W0 + imm, setting SP back to FP and restoring the registers pushed by CALLW. imm is signed 16 bits
+  RYVM_OP_TCALLW,  // TCALLW #imm            ; tail call from a subroutine called by CALLW: set SP back to FP, then jump to the PC-relative offset imm. LR and the frame pushed by CALLW are kept, so the target returns straight to the caller. imm is signed 24 bits
+
+  RYVM_OP_COUNT,   // not an opcode, the number of opcodes above. New opcodes go before it
 };
 
 enum ryvm_ins_format {
@@ -67,6 +135,13 @@ int ryvm_opcode_str_to_op(const char *s, enum ryvm_opcode *code);
 const char * ryvm_opcode_op_to_str(enum ryvm_opcode op);
 enum ryvm_ins_format ryvm_opcode_get_ins_format(enum ryvm_opcode op);
 
+//returns the number of bytes in the extension words that follow the instruction,
+//which hold the wide immediate of LDI32, LDI64, and the *I32 opcodes. Returns 0 for all other opcodes.
+uint8_t ryvm_opcode_ext_size(enum ryvm_opcode op);
+
+//returns 1 if the opcode can jump somewhere other than the next instruction
+int ryvm_opcode_is_jump(enum ryvm_opcode op);
+
 
 #endif// RYVM_OPCODE_H
 
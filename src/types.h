@@ -32,7 +32,7 @@ union num {
 
   uint16_t u16;
   int16_t s16;
-  float f16;
+  uint16_t f16; //the bits of an IEEE half precision float (see src/minifloat.h)
 
   uint8_t u8;
   int8_t s8;
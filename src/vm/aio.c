@@ -0,0 +1,329 @@
+//pthreads, pread, and pwrite are not part of C99, so we need to ask for them
+//before any system headers are included.
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include "aio.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <pthread.h>
+  #include <unistd.h>
+  #include <fcntl.h>
+  #include <errno.h>
+  #define RYVM_AIO_SUPPORTED 1
+#else
+  #define RYVM_AIO_SUPPORTED 0
+#endif
+
+
+#if RYVM_AIO_SUPPORTED
+
+//a request copied out of the submission queue, so the guest can reuse the slot right away
+struct ryvm_aio_job {
+  struct ryvm_aio_sqe sqe;
+  int64_t result;
+  struct ryvm_aio_job *next;
+};
+
+struct ryvm_aio {
+  struct ryvm_aio_ring_header *header;
+  struct ryvm_aio_sqe *sq;
+  struct ryvm_aio_cqe *cq;
+  uint64_t num_entries;
+
+  //one job per ring entry, so there can never be more requests in flight than
+  //free slots in the completion queue.
+  struct ryvm_aio_job *jobs;
+
+  //only used by the interpreter thread
+  struct ryvm_aio_job *free_jobs;
+  uint64_t in_flight; //taken from the submission queue, but not published to the completion queue yet
+
+  //shared with the workers. Only the interpreter thread ever touches the ring, 
+  //so the guest does not need atomics to read or write it.
+  pthread_mutex_t lock;
+  pthread_cond_t has_pending;
+  pthread_cond_t has_done;
+  struct ryvm_aio_job *pending_head;
+  struct ryvm_aio_job *pending_tail;
+  struct ryvm_aio_job *done_head;
+  struct ryvm_aio_job *done_tail;
+  uint8_t stopping;
+
+  pthread_t workers[RYVM_AIO_MAX_WORKERS];
+  uint32_t num_workers;
+};
+
+
+static int64_t ryvm_aio_execute(const struct ryvm_aio_sqe *sqe) {
+  int fd = (int) sqe->fd;
+  void *address = (void*) sqe->address;
+  ssize_t result;
+
+  switch(sqe->op) {
+    case RYVM_AIO_OP_READ:
+      result = sqe->offset == RYVM_AIO_OFFSET_CURRENT 
+        ? read(fd, address, sqe->length) 
+        : pread(fd, address, sqe->length, (off_t) sqe->offset);
+      break;
+    case RYVM_AIO_OP_WRITE:
+      result = sqe->offset == RYVM_AIO_OFFSET_CURRENT 
+        ? write(fd, address, sqe->length) 
+        : pwrite(fd, address, sqe->length, (off_t) sqe->offset);
+      break;
+    case RYVM_AIO_OP_OPEN: {
+      int flags;
+      switch(sqe->length) {
+        case RYVM_AIO_OPEN_READ: flags = O_RDONLY; break;
+        case RYVM_AIO_OPEN_WRITE: flags = O_WRONLY | O_CREAT | O_TRUNC; break;
+        case RYVM_AIO_OPEN_APPEND: flags = O_WRONLY | O_CREAT | O_APPEND; break;
+        default: return -EINVAL;
+      }
+      result = open((const char*) address, flags, 0644);
+      break;
+    }
+    case RYVM_AIO_OP_CLOSE:
+      result = close(fd);
+      break;
+    default:
+      return -EINVAL;
+  }
+
+  return result < 0 ? -errno : (int64_t) result;
+}
+
+static void* ryvm_aio_worker(void *arg) {
+  struct ryvm_aio *aio = arg;
+
+  pthread_mutex_lock(&aio->lock);
+  for(;;) {
+    while(aio->pending_head == NULL && !aio->stopping) {
+      pthread_cond_wait(&aio->has_pending, &aio->lock);
+    }
+
+    //finish everything that was submitted before stopping
+    if(aio->pending_head == NULL) {
+      break;
+    }
+
+    struct ryvm_aio_job *job = aio->pending_head;
+    aio->pending_head = job->next;
+    if(aio->pending_head == NULL) {
+      aio->pending_tail = NULL;
+    }
+
+    pthread_mutex_unlock(&aio->lock);
+    job->result = ryvm_aio_execute(&job->sqe);
+    pthread_mutex_lock(&aio->lock);
+
+    job->next = NULL;
+    if(aio->done_tail == NULL) {
+      aio->done_head = job;
+    } else {
+      aio->done_tail->next = job;
+    }
+    aio->done_tail = job;
+    pthread_cond_signal(&aio->has_done);
+  }
+  pthread_mutex_unlock(&aio->lock);
+
+  return NULL;
+}
+
+//stop the first num_workers workers. Must be called without holding the lock.
+static void ryvm_aio_stop_workers(struct ryvm_aio *aio, uint32_t num_workers) {
+  pthread_mutex_lock(&aio->lock);
+  aio->stopping = 1;
+  pthread_cond_broadcast(&aio->has_pending);
+  pthread_mutex_unlock(&aio->lock);
+
+  for(uint32_t i = 0; i < num_workers; i++) {
+    pthread_join(aio->workers[i], NULL);
+  }
+}
+
+struct ryvm_aio* ryvm_aio_create(uint8_t *ring, uint64_t num_entries, uint32_t num_workers) {
+  if(ring == NULL || ((uintptr_t) ring & 7) != 0) {
+    return NULL;
+  }
+
+  //the number of entries must be a power of 2 so that indices can wrap around with a mask
+  if(num_entries == 0 || num_entries > RYVM_AIO_MAX_ENTRIES || (num_entries & (num_entries - 1)) != 0) {
+    return NULL;
+  }
+
+  if(num_workers == 0) {
+    num_workers = RYVM_AIO_DEFAULT_WORKERS;
+  } else if(num_workers > RYVM_AIO_MAX_WORKERS) {
+    num_workers = RYVM_AIO_MAX_WORKERS;
+  }
+
+  struct ryvm_aio *aio = malloc(sizeof(struct ryvm_aio));
+  if(aio == NULL) {
+    return NULL;
+  }
+
+  aio->jobs = malloc(num_entries * sizeof(struct ryvm_aio_job));
+  if(aio->jobs == NULL) {
+    free(aio);
+    return NULL;
+  }
+
+  aio->header = (struct ryvm_aio_ring_header*) ring;
+  aio->sq = (struct ryvm_aio_sqe*) (ring + sizeof(struct ryvm_aio_ring_header));
+  aio->cq = (struct ryvm_aio_cqe*) (aio->sq + num_entries);
+  aio->num_entries = num_entries;
+  memset(aio->header, 0, sizeof(struct ryvm_aio_ring_header));
+
+  aio->free_jobs = NULL;
+  for(uint64_t i = 0; i < num_entries; i++) {
+    aio->jobs[i].next = aio->free_jobs;
+    aio->free_jobs = &aio->jobs[i];
+  }
+  aio->in_flight = 0;
+
+  aio->pending_head = NULL;
+  aio->pending_tail = NULL;
+  aio->done_head = NULL;
+  aio->done_tail = NULL;
+  aio->stopping = 0;
+
+  pthread_mutex_init(&aio->lock, NULL);
+  pthread_cond_init(&aio->has_pending, NULL);
+  pthread_cond_init(&aio->has_done, NULL);
+
+  for(aio->num_workers = 0; aio->num_workers < num_workers; aio->num_workers++) {
+    if(pthread_create(&aio->workers[aio->num_workers], NULL, ryvm_aio_worker, aio) != 0) {
+      ryvm_aio_stop_workers(aio, aio->num_workers);
+      pthread_mutex_destroy(&aio->lock);
+      pthread_cond_destroy(&aio->has_pending);
+      pthread_cond_destroy(&aio->has_done);
+      free(aio->jobs);
+      free(aio);
+      return NULL;
+    }
+  }
+
+  return aio;
+}
+
+//move finished jobs into the completion queue while there is room for them. Must hold the lock.
+static void ryvm_aio_publish_locked(struct ryvm_aio *aio) {
+  struct ryvm_aio_ring_header *header = aio->header;
+
+  while(aio->done_head != NULL && header->cq_tail - header->cq_head < aio->num_entries) {
+    struct ryvm_aio_job *job = aio->done_head;
+    aio->done_head = job->next;
+    if(aio->done_head == NULL) {
+      aio->done_tail = NULL;
+    }
+
+    struct ryvm_aio_cqe *cqe = &aio->cq[header->cq_tail & (aio->num_entries - 1)];
+    cqe->user_data = job->sqe.user_data;
+    cqe->result = job->result;
+    header->cq_tail++;
+
+    job->next = aio->free_jobs;
+    aio->free_jobs = job;
+    aio->in_flight--;
+  }
+}
+
+uint64_t ryvm_aio_submit(struct ryvm_aio *aio) {
+  struct ryvm_aio_ring_header *header = aio->header;
+  uint64_t num_submitted = 0;
+
+  pthread_mutex_lock(&aio->lock);
+
+  //anything that does not have a free job stays in the queue until the next submit
+  while(header->sq_head != header->sq_tail && aio->free_jobs != NULL) {
+    struct ryvm_aio_job *job = aio->free_jobs;
+    aio->free_jobs = job->next;
+
+    job->sqe = aio->sq[header->sq_head & (aio->num_entries - 1)];
+    job->next = NULL;
+    header->sq_head++;
+    aio->in_flight++;
+    num_submitted++;
+
+    if(aio->pending_tail == NULL) {
+      aio->pending_head = job;
+    } else {
+      aio->pending_tail->next = job;
+    }
+    aio->pending_tail = job;
+  }
+
+  if(num_submitted == 1) {
+    pthread_cond_signal(&aio->has_pending);
+  } else if(num_submitted > 1) {
+    pthread_cond_broadcast(&aio->has_pending);
+  }
+
+  ryvm_aio_publish_locked(aio);
+  pthread_mutex_unlock(&aio->lock);
+
+  return num_submitted;
+}
+
+uint64_t ryvm_aio_reap(struct ryvm_aio *aio, uint64_t min_complete) {
+  struct ryvm_aio_ring_header *header = aio->header;
+
+  pthread_mutex_lock(&aio->lock);
+  ryvm_aio_publish_locked(aio);
+
+  //stop waiting if the completion queue is full (done_head is not empty after publishing), 
+  //or if there is nothing left that could complete.
+  while(header->cq_tail - header->cq_head < min_complete && aio->in_flight > 0 && aio->done_head == NULL) {
+    pthread_cond_wait(&aio->has_done, &aio->lock);
+    ryvm_aio_publish_locked(aio);
+  }
+
+  uint64_t num_ready = header->cq_tail - header->cq_head;
+  pthread_mutex_unlock(&aio->lock);
+
+  return num_ready;
+}
+
+void ryvm_aio_free(struct ryvm_aio *aio) {
+  if(aio == NULL) {
+    return;
+  }
+
+  ryvm_aio_stop_workers(aio, aio->num_workers);
+  pthread_mutex_destroy(&aio->lock);
+  pthread_cond_destroy(&aio->has_pending);
+  pthread_cond_destroy(&aio->has_done);
+  free(aio->jobs);
+  free(aio);
+}
+
+#else
+
+//without POSIX threads and file descriptors, async I/O is not available and setting up a ring always fails.
+
+struct ryvm_aio* ryvm_aio_create(uint8_t *ring, uint64_t num_entries, uint32_t num_workers) {
+  (void) ring;
+  (void) num_entries;
+  (void) num_workers;
+  return NULL;
+}
+
+uint64_t ryvm_aio_submit(struct ryvm_aio *aio) {
+  (void) aio;
+  return 0;
+}
+
+uint64_t ryvm_aio_reap(struct ryvm_aio *aio, uint64_t min_complete) {
+  (void) aio;
+  (void) min_complete;
+  return 0;
+}
+
+void ryvm_aio_free(struct ryvm_aio *aio) {
+  (void) aio;
+}
+
+#endif
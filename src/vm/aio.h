@@ -0,0 +1,76 @@
+#ifndef RYVM_AIO_H
+#define RYVM_AIO_H
+
+#include <stdint.h>
+
+//the most entries a ring can have. The number of entries must also be a power of 2.
+#define RYVM_AIO_MAX_ENTRIES 4096
+
+//the most threads that can service a ring, and the amount used if the guest asks for 0
+#define RYVM_AIO_MAX_WORKERS 16
+#define RYVM_AIO_DEFAULT_WORKERS 4
+
+enum ryvm_aio_op {
+  RYVM_AIO_OP_READ,   //read length bytes from fd into address at offset. Returns the number of bytes read.
+  RYVM_AIO_OP_WRITE,  //write length bytes from address into fd at offset. Returns the number of bytes written.
+  RYVM_AIO_OP_OPEN,   //open the file whose null-terminated path is at address, using a ryvm_aio_open_mode in length. Returns the new fd.
+  RYVM_AIO_OP_CLOSE,  //close fd. Returns 0.
+};
+
+enum ryvm_aio_open_mode {
+  RYVM_AIO_OPEN_READ,     //open an existing file for reading
+  RYVM_AIO_OPEN_WRITE,    //create or truncate a file for writing
+  RYVM_AIO_OPEN_APPEND,   //create a file or append to the end of it
+};
+
+//when used as the offset of a read or write, the current position of the file is used instead.
+//This is required for pipes and terminals.
+#define RYVM_AIO_OFFSET_CURRENT UINT64_MAX
+
+//Layout of a ring in guest memory. It must be aligned to 8 bytes.
+//  b32 ryvm_aio_ring_header
+//  b(48 * num_entries) submission queue (struct ryvm_aio_sqe)
+//  b(16 * num_entries) completion queue (struct ryvm_aio_cqe)
+struct ryvm_aio_ring_header {
+  uint64_t sq_head; //next submission the VM will read, only changed by the VM
+  uint64_t sq_tail; //next free submission slot, only changed by the guest
+  uint64_t cq_head; //next completion the guest will read, only changed by the guest
+  uint64_t cq_tail; //next free completion slot, only changed by the VM
+};
+
+struct ryvm_aio_sqe {
+  uint64_t op;        //enum ryvm_aio_op
+  uint64_t fd;
+  uint64_t address;
+  uint64_t length;
+  uint64_t offset;
+  uint64_t user_data; //copied to the completion so the guest can tell requests apart
+};
+
+struct ryvm_aio_cqe {
+  uint64_t user_data;
+  int64_t result;     //negative errno on failure
+};
+
+#define RYVM_AIO_RING_SIZE(num_entries) (sizeof(struct ryvm_aio_ring_header) + (num_entries) * (sizeof(struct ryvm_aio_sqe) + sizeof(struct ryvm_aio_cqe)))
+
+
+struct ryvm_aio;
+
+//start servicing a ring stored in guest memory. Returns NULL if the ring is invalid or
+//the worker threads cannot be started.
+struct ryvm_aio* ryvm_aio_create(uint8_t *ring, uint64_t num_entries, uint32_t num_workers);
+
+//hand every new submission to the worker threads and publish any finished requests.
+//Returns the number of submissions taken from the queue.
+uint64_t ryvm_aio_submit(struct ryvm_aio *aio);
+
+//publish finished requests, waiting until at least min_complete completions are ready for the guest
+//or nothing is left in flight. Returns the number of completions ready for the guest.
+uint64_t ryvm_aio_reap(struct ryvm_aio *aio, uint64_t min_complete);
+
+//wait for any requests in flight, then stop the worker threads. The ring itself is left alone.
+void ryvm_aio_free(struct ryvm_aio *aio);
+
+
+#endif // RYVM_AIO_H
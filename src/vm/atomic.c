@@ -0,0 +1,119 @@
+#include "atomic.h"
+#include <assert.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define RYVM_ATOMIC_HAS_BUILTINS 1
+#else
+  #define RYVM_ATOMIC_HAS_BUILTINS 0
+#endif
+
+
+#if RYVM_ATOMIC_HAS_BUILTINS
+
+//the __atomic builtins are generic, so one macro covers every bytewidth
+#define RYVM_ATOMIC_SWITCH(bytewidth, OP) \
+  switch(bytewidth) { \
+    case 1: { OP(uint8_t) } \
+    case 2: { OP(uint16_t) } \
+    case 4: { OP(uint32_t) } \
+    case 8: { OP(uint64_t) } \
+    default: assert(0); \
+  }
+
+uint64_t ryvm_atomic_cas(void *address, uint64_t expected, uint64_t desired, uint8_t bytewidth) {
+  #define RYVM_ATOMIC_CAS(type) \
+    type old = (type) expected; \
+    __atomic_compare_exchange_n((type*) address, &old, (type) desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); \
+    return old;
+  RYVM_ATOMIC_SWITCH(bytewidth, RYVM_ATOMIC_CAS)
+  #undef RYVM_ATOMIC_CAS
+  return 0;
+}
+
+uint64_t ryvm_atomic_fetch_add(void *address, uint64_t value, uint8_t bytewidth) {
+  #define RYVM_ATOMIC_FETCH_ADD(type) return __atomic_fetch_add((type*) address, (type) value, __ATOMIC_SEQ_CST);
+  RYVM_ATOMIC_SWITCH(bytewidth, RYVM_ATOMIC_FETCH_ADD)
+  #undef RYVM_ATOMIC_FETCH_ADD
+  return 0;
+}
+
+uint64_t ryvm_atomic_load_acquire(void *address, uint8_t bytewidth) {
+  #define RYVM_ATOMIC_LOAD(type) return __atomic_load_n((type*) address, __ATOMIC_ACQUIRE);
+  RYVM_ATOMIC_SWITCH(bytewidth, RYVM_ATOMIC_LOAD)
+  #undef RYVM_ATOMIC_LOAD
+  return 0;
+}
+
+void ryvm_atomic_store_release(void *address, uint64_t value, uint8_t bytewidth) {
+  #define RYVM_ATOMIC_STORE(type) __atomic_store_n((type*) address, (type) value, __ATOMIC_RELEASE); return;
+  RYVM_ATOMIC_SWITCH(bytewidth, RYVM_ATOMIC_STORE)
+  #undef RYVM_ATOMIC_STORE
+}
+
+void ryvm_atomic_fence(void) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#else
+
+//Without compiler builtins, every atomic operation takes the same lock. The lock and unlock calls
+//are full barriers, which gives us the same ordering as the builtins (just slower).
+//Platforms without pthreads cannot spawn threads at all, so plain memory accesses are enough there.
+#if defined(__unix__) || defined(__APPLE__)
+  #include <pthread.h>
+  static pthread_mutex_t ryvm_atomic_lock = PTHREAD_MUTEX_INITIALIZER;
+  #define RYVM_ATOMIC_LOCK() pthread_mutex_lock(&ryvm_atomic_lock)
+  #define RYVM_ATOMIC_UNLOCK() pthread_mutex_unlock(&ryvm_atomic_lock)
+#else
+  #define RYVM_ATOMIC_LOCK()
+  #define RYVM_ATOMIC_UNLOCK()
+#endif
+
+#include <string.h>
+
+static uint64_t ryvm_atomic_read(void *address, uint8_t bytewidth) {
+  assert(bytewidth == 1 || bytewidth == 2 || bytewidth == 4 || bytewidth == 8);
+  uint64_t value = 0;
+  memcpy(&value, address, bytewidth);
+  return value;
+}
+
+uint64_t ryvm_atomic_cas(void *address, uint64_t expected, uint64_t desired, uint8_t bytewidth) {
+  RYVM_ATOMIC_LOCK();
+  uint64_t old = ryvm_atomic_read(address, bytewidth);
+  uint64_t mask = bytewidth == 8 ? UINT64_MAX : (((uint64_t) 1 << (bytewidth * 8)) - 1);
+  if(old == (expected & mask)) {
+    memcpy(address, &desired, bytewidth);
+  }
+  RYVM_ATOMIC_UNLOCK();
+  return old;
+}
+
+uint64_t ryvm_atomic_fetch_add(void *address, uint64_t value, uint8_t bytewidth) {
+  RYVM_ATOMIC_LOCK();
+  uint64_t old = ryvm_atomic_read(address, bytewidth);
+  uint64_t sum = old + value;
+  memcpy(address, &sum, bytewidth);
+  RYVM_ATOMIC_UNLOCK();
+  return old;
+}
+
+uint64_t ryvm_atomic_load_acquire(void *address, uint8_t bytewidth) {
+  RYVM_ATOMIC_LOCK();
+  uint64_t value = ryvm_atomic_read(address, bytewidth);
+  RYVM_ATOMIC_UNLOCK();
+  return value;
+}
+
+void ryvm_atomic_store_release(void *address, uint64_t value, uint8_t bytewidth) {
+  RYVM_ATOMIC_LOCK();
+  memcpy(address, &value, bytewidth);
+  RYVM_ATOMIC_UNLOCK();
+}
+
+void ryvm_atomic_fence(void) {
+  RYVM_ATOMIC_LOCK();
+  RYVM_ATOMIC_UNLOCK();
+}
+
+#endif
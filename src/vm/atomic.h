@@ -0,0 +1,24 @@
+#ifndef RYVM_ATOMIC_H
+#define RYVM_ATOMIC_H
+
+#include <stdint.h>
+
+//Atomic memory operations used by the CAS, LDADD, LDAR, STLR, and FENCE opcodes.
+//The address must be aligned to the bytewidth, which is 1, 2, 4, or 8 bytes.
+//Values are zero-extended to 64 bits when they are returned.
+
+//sequentially consistent compare-and-swap. If the value at address equals expected, desired is stored there.
+//Returns the value that was at address before the operation.
+uint64_t ryvm_atomic_cas(void *address, uint64_t expected, uint64_t desired, uint8_t bytewidth);
+
+//sequentially consistent fetch-and-add. Returns the value that was at address before the addition.
+uint64_t ryvm_atomic_fetch_add(void *address, uint64_t value, uint8_t bytewidth);
+
+uint64_t ryvm_atomic_load_acquire(void *address, uint8_t bytewidth);
+void ryvm_atomic_store_release(void *address, uint64_t value, uint8_t bytewidth);
+
+//full sequentially consistent memory barrier
+void ryvm_atomic_fence(void);
+
+
+#endif // RYVM_ATOMIC_H
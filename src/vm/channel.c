@@ -0,0 +1,186 @@
+//sched_yield is not part of C99, so we need to ask for it before any system headers are included.
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include <stdlib.h>
+
+#include "channel.h"
+#include "atomic.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sched.h>
+  #define RYVM_CHANNEL_YIELD() sched_yield()
+#else
+  #define RYVM_CHANNEL_YIELD()
+#endif
+
+//number of failed attempts before a waiting thread starts giving up the CPU
+#define RYVM_CHANNEL_SPIN_COUNT 64
+
+#define RYVM_CHANNEL_CACHE_LINE 64
+
+//set in send_pos once the channel is closed. Closing and claiming a cell both change send_pos,
+//so a sender either claims its cell before the channel is closed, or sees the bit and fails.
+#define RYVM_CHANNEL_CLOSED_BIT (1ull << 63)
+
+//Each cell has a sequence number that says whose turn it is to use the cell.
+//For the cell at position pos:
+//- sequence == pos means the cell is empty and a sender can claim it.
+//- sequence == pos + 1 means the cell is full and a receiver can claim it.
+//This is Dmitry Vyukov's bounded MPMC queue.
+struct ryvm_channel_cell {
+  uint64_t sequence;
+  uint64_t value;
+};
+
+struct ryvm_channel {
+  struct ryvm_channel_cell *cells;
+  uint64_t mask;
+
+  //senders and receivers each get their own cache line so they do not slow each other down
+  uint8_t pad0[RYVM_CHANNEL_CACHE_LINE];
+  uint64_t send_pos;
+  uint8_t pad1[RYVM_CHANNEL_CACHE_LINE - sizeof(uint64_t)];
+  uint64_t receive_pos;
+  uint8_t pad2[RYVM_CHANNEL_CACHE_LINE - sizeof(uint64_t)];
+};
+
+
+struct ryvm_channel* ryvm_channel_create(uint64_t capacity) {
+  if(capacity == 0 || capacity > RYVM_CHANNEL_MAX_CAPACITY) {
+    return NULL;
+  }
+
+  uint64_t size = 1;
+  while(size < capacity) {
+    size <<= 1;
+  }
+
+  struct ryvm_channel *channel = malloc(sizeof(struct ryvm_channel));
+  if(channel == NULL) {
+    return NULL;
+  }
+
+  channel->cells = malloc(size * sizeof(struct ryvm_channel_cell));
+  if(channel->cells == NULL) {
+    free(channel);
+    return NULL;
+  }
+
+  for(uint64_t i = 0; i < size; i++) {
+    channel->cells[i].sequence = i;
+  }
+  channel->mask = size - 1;
+  channel->send_pos = 0;
+  channel->receive_pos = 0;
+
+  return channel;
+}
+
+void ryvm_channel_close(struct ryvm_channel *channel) {
+  uint64_t pos = ryvm_atomic_load_acquire(&channel->send_pos, 8);
+  while(!(pos & RYVM_CHANNEL_CLOSED_BIT)) {
+    uint64_t old = ryvm_atomic_cas(&channel->send_pos, pos, pos | RYVM_CHANNEL_CLOSED_BIT, 8);
+    if(old == pos) {
+      break;
+    }
+    pos = old;
+  }
+}
+
+void ryvm_channel_free(struct ryvm_channel *channel) {
+  if(channel == NULL) {
+    return;
+  }
+  free(channel->cells);
+  free(channel);
+}
+
+enum ryvm_channel_status ryvm_channel_send(struct ryvm_channel *channel, uint64_t value) {
+  uint64_t pos = ryvm_atomic_load_acquire(&channel->send_pos, 8);
+  struct ryvm_channel_cell *cell;
+
+  for(;;) {
+    if(pos & RYVM_CHANNEL_CLOSED_BIT) {
+      return RYVM_CHANNEL_STATUS_CLOSED;
+    }
+
+    cell = &channel->cells[pos & channel->mask];
+    uint64_t sequence = ryvm_atomic_load_acquire(&cell->sequence, 8);
+    int64_t diff = (int64_t) (sequence - pos);
+
+    if(diff == 0) {
+      //the cell is empty, try to claim it
+      uint64_t old = ryvm_atomic_cas(&channel->send_pos, pos, pos + 1, 8);
+      if(old == pos) {
+        break;
+      }
+      pos = old;
+    } else if(diff < 0) {
+      //a receiver has not emptied this cell yet, so the channel is full
+      return RYVM_CHANNEL_STATUS_WOULD_BLOCK;
+    } else {
+      //another sender claimed this cell first
+      pos = ryvm_atomic_load_acquire(&channel->send_pos, 8);
+    }
+  }
+
+  cell->value = value;
+  ryvm_atomic_store_release(&cell->sequence, pos + 1, 8);
+  return RYVM_CHANNEL_STATUS_OK;
+}
+
+enum ryvm_channel_status ryvm_channel_receive(struct ryvm_channel *channel, uint64_t *value) {
+  uint64_t pos = ryvm_atomic_load_acquire(&channel->receive_pos, 8);
+  struct ryvm_channel_cell *cell;
+
+  for(;;) {
+    cell = &channel->cells[pos & channel->mask];
+    uint64_t sequence = ryvm_atomic_load_acquire(&cell->sequence, 8);
+    int64_t diff = (int64_t) (sequence - (pos + 1));
+
+    if(diff == 0) {
+      //the cell is full, try to claim it
+      uint64_t old = ryvm_atomic_cas(&channel->receive_pos, pos, pos + 1, 8);
+      if(old == pos) {
+        break;
+      }
+      pos = old;
+    } else if(diff < 0) {
+      //the channel is empty. It is done if it is closed and every cell claimed before that was received,
+      //otherwise a sender has claimed this cell and not filled it yet.
+      uint64_t send_pos = ryvm_atomic_load_acquire(&channel->send_pos, 8);
+      if(send_pos == (pos | RYVM_CHANNEL_CLOSED_BIT)) {
+        return RYVM_CHANNEL_STATUS_CLOSED;
+      }
+      return RYVM_CHANNEL_STATUS_WOULD_BLOCK;
+    } else {
+      //another receiver claimed this cell first
+      pos = ryvm_atomic_load_acquire(&channel->receive_pos, 8);
+    }
+  }
+
+  *value = cell->value;
+  ryvm_atomic_store_release(&cell->sequence, pos + channel->mask + 1, 8);
+  return RYVM_CHANNEL_STATUS_OK;
+}
+
+enum ryvm_channel_status ryvm_channel_send_wait(struct ryvm_channel *channel, uint64_t value) {
+  enum ryvm_channel_status status;
+  for(uint32_t attempts = 0; (status = ryvm_channel_send(channel, value)) == RYVM_CHANNEL_STATUS_WOULD_BLOCK; attempts++) {
+    if(attempts >= RYVM_CHANNEL_SPIN_COUNT) {
+      RYVM_CHANNEL_YIELD();
+    }
+  }
+  return status;
+}
+
+enum ryvm_channel_status ryvm_channel_receive_wait(struct ryvm_channel *channel, uint64_t *value) {
+  enum ryvm_channel_status status;
+  for(uint32_t attempts = 0; (status = ryvm_channel_receive(channel, value)) == RYVM_CHANNEL_STATUS_WOULD_BLOCK; attempts++) {
+    if(attempts >= RYVM_CHANNEL_SPIN_COUNT) {
+      RYVM_CHANNEL_YIELD();
+    }
+  }
+  return status;
+}
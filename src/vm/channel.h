@@ -0,0 +1,37 @@
+#ifndef RYVM_CHANNEL_H
+#define RYVM_CHANNEL_H
+
+#include <stdint.h>
+
+//the most messages a channel can hold
+#define RYVM_CHANNEL_MAX_CAPACITY (1024 * 1024)
+
+enum ryvm_channel_status {
+  RYVM_CHANNEL_STATUS_WOULD_BLOCK = 0, //the channel is full (send) or empty (receive)
+  RYVM_CHANNEL_STATUS_OK = 1,
+  RYVM_CHANNEL_STATUS_CLOSED = 2,      //the channel was closed, and nothing is left to receive
+};
+
+//A bounded queue of 64-bit messages that any number of threads can send to and receive from
+//without taking a lock. To hand off a buffer without copying it, send its address.
+struct ryvm_channel;
+
+//capacity is rounded up to a power of 2. Returns NULL on failure.
+struct ryvm_channel* ryvm_channel_create(uint64_t capacity);
+
+//no new messages can be sent after a channel is closed, but the messages already in it can still be received.
+void ryvm_channel_close(struct ryvm_channel *channel);
+
+//the channel must not be used by any VM after it is freed
+void ryvm_channel_free(struct ryvm_channel *channel);
+
+enum ryvm_channel_status ryvm_channel_send(struct ryvm_channel *channel, uint64_t value);
+enum ryvm_channel_status ryvm_channel_receive(struct ryvm_channel *channel, uint64_t *value);
+
+//same as the functions above, but waits instead of returning RYVM_CHANNEL_STATUS_WOULD_BLOCK.
+//Waiting spins for a short while, then gives up the CPU between attempts.
+enum ryvm_channel_status ryvm_channel_send_wait(struct ryvm_channel *channel, uint64_t value);
+enum ryvm_channel_status ryvm_channel_receive_wait(struct ryvm_channel *channel, uint64_t *value);
+
+
+#endif // RYVM_CHANNEL_H
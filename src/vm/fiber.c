@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "fiber.h"
+#include "vm.h"
+#include "../helper.h"
+
+//fibers start with their link register pointing here, so returning from the 
+//entry function of a fiber exits it with W0 as the result.
+static const uint8_t ryvm_fiber_exit_ins[RYVM_INS_SIZE] = {RYVM_OP_SYS, 19, 0, 0};
+
+
+static void ryvm_fiber_switch(struct ryvm *vm, struct ryvm_fiber *fiber) {
+  vm->current_fiber = fiber;
+  vm->gen_registers = fiber->registers;
+}
+
+//insert fiber right before pos, which puts it at the end of the run queue when pos is running
+static void ryvm_fiber_link_before(struct ryvm_fiber *pos, struct ryvm_fiber *fiber) {
+  fiber->next = pos;
+  fiber->prev = pos->prev;
+  pos->prev->next = fiber;
+  pos->prev = fiber;
+}
+
+//remove fiber from the run queue. Returns the fiber after it, or NULL if the queue is now empty.
+static struct ryvm_fiber* ryvm_fiber_unlink(struct ryvm_fiber *fiber) {
+  if(fiber->next == fiber) {
+    return NULL;
+  }
+  fiber->prev->next = fiber->next;
+  fiber->next->prev = fiber->prev;
+  return fiber->next;
+}
+
+static void ryvm_fiber_release(struct ryvm *vm, struct ryvm_fiber *fiber) {
+  free(fiber->stack);
+  fiber->stack = NULL;
+  fiber->state = RYVM_FIBER_STATE_FREE;
+  fiber->next = vm->free_fibers;
+  vm->free_fibers = fiber;
+}
+
+static struct ryvm_fiber* ryvm_fiber_get(struct ryvm *vm, uint64_t id) {
+  if(vm->current_fiber == NULL || id >= vm->fibers.array_length) {
+    return NULL;
+  }
+  return memory_array_builder_get_element_at(&vm->fibers, (unsigned int) id);
+}
+
+//get a fiber record, either by reusing a free one or adding a new one
+static struct ryvm_fiber* ryvm_fiber_alloc(struct ryvm *vm) {
+  if(vm->free_fibers != NULL) {
+    struct ryvm_fiber *fiber = vm->free_fibers;
+    vm->free_fibers = fiber->next;
+    return fiber;
+  }
+
+  struct ryvm_fiber fiber;
+  fiber.id = vm->fibers.array_length;
+  if(!memory_array_builder_append_element(&vm->fibers, &fiber)) {
+    return NULL;
+  }
+  return memory_array_builder_get_element_at(&vm->fibers, (unsigned int) fiber.id);
+}
+
+//the first time a fiber is created, the code that is already running becomes fiber 0.
+static int ryvm_fiber_init_main(struct ryvm *vm) {
+  //fibers are stored in a linked list of blocks, so that pointers to them never move
+  if(!memory_array_builder_init(&vm->fibers, 16, sizeof(struct ryvm_fiber), MEMORY_ALLOCATOR_REGION_LINKED_LIST)) {
+    return 0;
+  }
+  vm->free_fibers = NULL;
+
+  struct ryvm_fiber *main_fiber = ryvm_fiber_alloc(vm);
+  if(main_fiber == NULL) {
+    memory_array_builder_free(&vm->fibers);
+    return 0;
+  }
+
+  memcpy(main_fiber->registers, vm->gen_registers, sizeof(main_fiber->registers));
+  main_fiber->stack = NULL;
+  main_fiber->state = RYVM_FIBER_STATE_RUNNABLE;
+  main_fiber->next = main_fiber;
+  main_fiber->prev = main_fiber;
+  main_fiber->joiner = NULL;
+
+  ryvm_fiber_switch(vm, main_fiber);
+  return 1;
+}
+
+int ryvm_fiber_create(struct ryvm *vm, uint64_t entry, uint64_t stack_size, uint64_t arg, uint64_t *id) {
+  if(vm->current_fiber == NULL && !ryvm_fiber_init_main(vm)) {
+    return 0;
+  }
+
+  if(stack_size == 0) {
+    stack_size = RYVM_FIBER_DEFAULT_STACK_SIZE;
+  }
+
+  uint8_t *stack = malloc(stack_size);
+  if(stack == NULL) {
+    return 0;
+  }
+
+  struct ryvm_fiber *fiber = ryvm_fiber_alloc(vm);
+  if(fiber == NULL) {
+    free(stack);
+    return 0;
+  }
+
+  memset(fiber->registers, 0, sizeof(fiber->registers));
+  fiber->registers[0] = arg;
+  fiber->registers[RYVM_PC_REG] = entry;
+  fiber->registers[RYVM_SP_REG] = (uint64_t) stack;
+  fiber->registers[RYVM_FP_REG] = (uint64_t) stack;
+  fiber->registers[RYVM_LR_REG] = (uint64_t) ryvm_fiber_exit_ins;
+
+  fiber->stack = stack;
+  fiber->result = 0;
+  fiber->state = RYVM_FIBER_STATE_RUNNABLE;
+  fiber->joiner = NULL;
+  ryvm_fiber_link_before(vm->current_fiber, fiber);
+
+  *id = fiber->id;
+  return 1;
+}
+
+void ryvm_fiber_yield(struct ryvm *vm) {
+  if(vm->current_fiber != NULL) {
+    ryvm_fiber_switch(vm, vm->current_fiber->next);
+  }
+}
+
+enum ryvm_fiber_status ryvm_fiber_join(struct ryvm *vm, uint64_t id) {
+  struct ryvm_fiber *current = vm->current_fiber;
+  struct ryvm_fiber *fiber = ryvm_fiber_get(vm, id);
+  if(fiber == NULL || fiber == current || fiber->state == RYVM_FIBER_STATE_FREE || fiber->joiner != NULL) {
+    return RYVM_FIBER_STATUS_INVALID;
+  }
+
+  if(fiber->state == RYVM_FIBER_STATE_FINISHED) {
+    current->registers[0] = fiber->result;
+    ryvm_fiber_release(vm, fiber);
+    return RYVM_FIBER_STATUS_OK;
+  }
+
+  //sleep until the fiber exits
+  fiber->joiner = current;
+  current->state = RYVM_FIBER_STATE_JOINING;
+
+  struct ryvm_fiber *next = ryvm_fiber_unlink(current);
+  if(next == NULL) {
+    return RYVM_FIBER_STATUS_DEADLOCK;
+  }
+  ryvm_fiber_switch(vm, next);
+  return RYVM_FIBER_STATUS_OK;
+}
+
+enum ryvm_fiber_status ryvm_fiber_exit(struct ryvm *vm, uint64_t result) {
+  struct ryvm_fiber *current = vm->current_fiber;
+  if(current == NULL) {
+    return RYVM_FIBER_STATUS_INVALID;
+  }
+
+  current->result = result;
+  current->state = RYVM_FIBER_STATE_FINISHED;
+
+  struct ryvm_fiber *next = ryvm_fiber_unlink(current);
+
+  //wake up the fiber waiting for this one
+  struct ryvm_fiber *joiner = current->joiner;
+  if(joiner != NULL) {
+    joiner->registers[0] = result;
+    joiner->state = RYVM_FIBER_STATE_RUNNABLE;
+    if(next == NULL) {
+      joiner->next = joiner;
+      joiner->prev = joiner;
+      next = joiner;
+    } else {
+      ryvm_fiber_link_before(next, joiner);
+    }
+    ryvm_fiber_release(vm, current);
+  }
+
+  if(next == NULL) {
+    return RYVM_FIBER_STATUS_DEADLOCK;
+  }
+
+  ryvm_fiber_switch(vm, next);
+  return RYVM_FIBER_STATUS_OK;
+}
+
+void ryvm_fiber_free_all(struct ryvm *vm) {
+  if(vm->current_fiber == NULL) {
+    return;
+  }
+
+  for(size_t i = 0; i < vm->fibers.array_length; i++) {
+    struct ryvm_fiber *fiber = memory_array_builder_get_element_at(&vm->fibers, (unsigned int) i);
+    free(fiber->stack);
+  }
+  memory_array_builder_free(&vm->fibers);
+
+  vm->current_fiber = NULL;
+  vm->free_fibers = NULL;
+  vm->gen_registers = vm->main_registers;
+}
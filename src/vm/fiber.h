@@ -0,0 +1,58 @@
+#ifndef RYVM_FIBER_H
+#define RYVM_FIBER_H
+
+#include <stdint.h>
+
+//stack size used when a guest creates a fiber with a stack size of 0
+#define RYVM_FIBER_DEFAULT_STACK_SIZE (64 * 1024)
+
+struct ryvm;
+
+enum ryvm_fiber_state {
+  RYVM_FIBER_STATE_RUNNABLE,  //in the run queue
+  RYVM_FIBER_STATE_JOINING,   //waiting for another fiber to finish
+  RYVM_FIBER_STATE_FINISHED,  //exited, but nobody joined it yet
+  RYVM_FIBER_STATE_FREE,      //can be reused by the next fiber that is created
+};
+
+enum ryvm_fiber_status {
+  RYVM_FIBER_STATUS_DEADLOCK = -1, //no fiber is left that can run
+  RYVM_FIBER_STATUS_INVALID = 0,
+  RYVM_FIBER_STATUS_OK = 1,
+};
+
+//a cooperative thread inside a single VM. Each fiber has its own register file,
+//so switching fibers only changes which register file the VM points to.
+struct ryvm_fiber {
+  uint64_t registers[64];
+
+  uint8_t *stack; //NULL for the main fiber, which uses the stack of the VM
+  uint64_t id;
+  uint64_t result;
+  enum ryvm_fiber_state state;
+
+  //neighbors in the circular run queue. For free fibers, next points to the next free fiber.
+  struct ryvm_fiber *next;
+  struct ryvm_fiber *prev;
+
+  struct ryvm_fiber *joiner; //the fiber waiting for this one to finish, or NULL
+};
+
+//create a fiber that starts at the instruction at entry with its argument in W0. The new fiber
+//is added to the end of the run queue, but does not run until the current fiber yields.
+//Returns 0 if the fiber cannot be allocated.
+int ryvm_fiber_create(struct ryvm *vm, uint64_t entry, uint64_t stack_size, uint64_t arg, uint64_t *id);
+
+//switch to the next fiber in the run queue
+void ryvm_fiber_yield(struct ryvm *vm);
+
+//wait for a fiber to finish. Its result is placed in W0 of the joining fiber.
+enum ryvm_fiber_status ryvm_fiber_join(struct ryvm *vm, uint64_t id);
+
+//finish the current fiber and switch to the next one
+enum ryvm_fiber_status ryvm_fiber_exit(struct ryvm *vm, uint64_t result);
+
+void ryvm_fiber_free_all(struct ryvm *vm);
+
+
+#endif // RYVM_FIBER_H
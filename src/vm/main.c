@@ -2,23 +2,56 @@
 #include <stdlib.h>
 #include <string.h>
 #include "vm.h"
+#include "../memory/pages.h"
+
+void ryvm_main_print_usage(void) {
+  printf("Usage: ryvm [--huge-pages | --huge-pages=tlb] [--profile] <file.ryc>\n");
+}
+
+//report how much of a region the OS actually backed with huge pages.
+void ryvm_main_print_page_summary(const char *name, void *region, uint64_t size) {
+  size_t huge_bytes = memory_pages_huge_bytes(region, size);
+  printf("  %s: %s (%zu bytes backed by huge pages, %llu bytes requested)\n", name, huge_bytes > 0 ? "yes" : "no", huge_bytes, (unsigned long long) size);
+}
 
 int main(int argc, char **argv) {
+  const char *input_path = NULL;
+  uint32_t page_flags = MEMORY_PAGE_FLAG_NONE;
+  uint8_t profiling = 0;
 
-  if(argc != 2) {
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--huge-pages") == 0) {
+      page_flags = MEMORY_PAGE_FLAG_HUGE;
+    } else if(strcmp(argv[i], "--huge-pages=tlb") == 0) {
+      page_flags = MEMORY_PAGE_FLAG_HUGETLBFS;
+    } else if(strcmp(argv[i], "--profile") == 0) {
+      profiling = 1;
+    } else if(input_path == NULL && argv[i][0] != '-') {
+      input_path = argv[i];
+    } else {
+      ryvm_main_print_usage();
+      return 1;
+    }
+  }
+
+  if(input_path == NULL) {
     printf("Must have 1 arguments!\n");
+    ryvm_main_print_usage();
     return 1;
   }
 
   //grab file from argv
 
-  FILE *in = fopen(argv[1], "r");
+  FILE *in = fopen(input_path, "r");
   if(in == NULL) {
-    printf("Cannot open input file %s\n", argv[1]);
+    printf("Cannot open input file %s\n", input_path);
     return 1;
   }
 
   struct ryvm vm;
+  ryvm_vm_init(&vm);
+  vm.page_flags = page_flags;
+
   if(!ryvm_vm_load(&vm, in)) {
     printf("Error while loading RYC file!\n");
     fclose(in);
@@ -28,8 +61,31 @@ int main(int argc, char **argv) {
   //we loaded program into memory, no need to read from input file anymore
   fclose(in);
 
+  struct ryvm_profile profile;
+  if(profiling) {
+    if(!ryvm_profile_init(&profile, vm.data_and_code_size - vm.text_section_start)) {
+      printf("Cannot allocate memory for the profile!\n");
+      ryvm_vm_free(&vm);
+      return 1;
+    }
+    vm.profile = &profile;
+  }
 
   printf("Program result: %lld\n", ryvm_vm_run(&vm));
+
+  if(profiling) {
+    ryvm_profile_report(&profile, vm.data_and_code + vm.text_section_start, &vm.symbols, RYVM_PROFILE_REPORT_BLOCKS);
+    ryvm_profile_free(&profile);
+  }
+
+  //check for huge pages after running, since the stack is only backed by
+  //physical pages once the program touches it.
+  if(page_flags != MEMORY_PAGE_FLAG_NONE) {
+    printf("Huge pages:\n");
+    ryvm_main_print_page_summary("data/text", vm.data_and_code, vm.data_and_code_size);
+    ryvm_main_print_page_summary("stack", vm.stack, vm.stack_size);
+  }
+
   ryvm_vm_free(&vm);
 
 
@@ -0,0 +1,114 @@
+//mmap, open, and fstat are not part of C99, so we need to ask for them
+//before any system headers are included.
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include "mapped_file.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #define RYVM_MAPPED_FILE_HAS_MMAP 1
+#else
+  #define RYVM_MAPPED_FILE_HAS_MMAP 0
+#endif
+
+
+#if RYVM_MAPPED_FILE_HAS_MMAP
+
+int ryvm_mapped_file_open(struct ryvm_mapped_file *file, const char *path, uint32_t mode) {
+  if(mode != RYVM_MAPPED_FILE_MODE_READ_ONLY && mode != RYVM_MAPPED_FILE_MODE_COPY_ON_WRITE) {
+    return 0;
+  }
+
+  int fd = open(path, O_RDONLY);
+  if(fd < 0) {
+    return 0;
+  }
+
+  struct stat info;
+  if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    close(fd);
+    return 0;
+  }
+
+  file->size = (uint64_t) info.st_size;
+  file->data = NULL;
+
+  //mmap does not allow mappings of length 0
+  if(file->size == 0) {
+    close(fd);
+    return 1;
+  }
+
+  //MAP_PRIVATE gives us copy-on-write pages, so the file itself is never modified
+  int prot = mode == RYVM_MAPPED_FILE_MODE_COPY_ON_WRITE ? PROT_READ | PROT_WRITE : PROT_READ;
+  void *data = mmap(NULL, file->size, prot, MAP_PRIVATE, fd, 0);
+
+  //the mapping keeps its own reference to the file
+  close(fd);
+
+  if(data == MAP_FAILED) {
+    return 0;
+  }
+
+  file->data = data;
+  return 1;
+}
+
+void ryvm_mapped_file_close(struct ryvm_mapped_file *file) {
+  if(file->data != NULL) {
+    munmap(file->data, file->size);
+  }
+  file->data = NULL;
+  file->size = 0;
+}
+
+#else
+
+//without mmap, the best we can do is read the whole file into memory.
+//Read-only mappings are not protected from writes.
+int ryvm_mapped_file_open(struct ryvm_mapped_file *file, const char *path, uint32_t mode) {
+  if(mode != RYVM_MAPPED_FILE_MODE_READ_ONLY && mode != RYVM_MAPPED_FILE_MODE_COPY_ON_WRITE) {
+    return 0;
+  }
+
+  FILE *f = fopen(path, "rb");
+  if(f == NULL) {
+    return 0;
+  }
+
+  long size;
+  if(fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0) {
+    fclose(f);
+    return 0;
+  }
+
+  file->size = (uint64_t) size;
+  file->data = NULL;
+
+  if(size != 0) {
+    file->data = malloc(file->size);
+    if(file->data == NULL || fread(file->data, file->size, 1, f) != 1) {
+      free(file->data);
+      file->data = NULL;
+      fclose(f);
+      return 0;
+    }
+  }
+
+  fclose(f);
+  return 1;
+}
+
+void ryvm_mapped_file_close(struct ryvm_mapped_file *file) {
+  free(file->data);
+  file->data = NULL;
+  file->size = 0;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef RYVM_MAPPED_FILE_H
+#define RYVM_MAPPED_FILE_H
+
+#include <stdint.h>
+
+enum ryvm_mapped_file_mode {
+  //writing to the mapping is not allowed
+  RYVM_MAPPED_FILE_MODE_READ_ONLY = 0,
+
+  //the mapping can be written to, but changes are private to the VM and never reach the file.
+  RYVM_MAPPED_FILE_MODE_COPY_ON_WRITE = 1,
+};
+
+//a file mapped into the address space of the VM
+struct ryvm_mapped_file {
+  uint8_t *data;
+  uint64_t size;
+};
+
+//map an entire file into memory. On POSIX systems, the file is mapped with mmap so that the pages are
+//served straight from the OS page cache. On other platforms, the file is read into a malloc'ed buffer.
+//An empty file is mapped with a NULL data pointer and a size of 0.
+//Returns 0 if the file cannot be opened or mapped.
+int ryvm_mapped_file_open(struct ryvm_mapped_file *file, const char *path, uint32_t mode);
+
+void ryvm_mapped_file_close(struct ryvm_mapped_file *file);
+
+
+#endif // RYVM_MAPPED_FILE_H
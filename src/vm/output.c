@@ -0,0 +1,148 @@
+//write is not part of C99, so we need to ask for it before any system headers are included.
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include "output.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <unistd.h>
+  #include <errno.h>
+  #define RYVM_OUTPUT_HAS_WRITE 1
+#else
+  #define RYVM_OUTPUT_HAS_WRITE 0
+#endif
+
+//the longest 64-bit integer in base 10, including the sign
+#define RYVM_OUTPUT_MAX_INT_DIGITS 20
+
+//every number from 00 to 99, so that we can convert 2 digits at a time
+static const char ryvm_output_digit_pairs[] = 
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+
+void ryvm_output_init(struct ryvm_output *out) {
+  out->buffer = NULL;
+  out->length = 0;
+}
+
+//write straight to standard output, bypassing the buffer
+static void ryvm_output_write_direct(const void *bytes, size_t size) {
+  //anything printf has buffered must come out first
+  fflush(stdout);
+
+#if RYVM_OUTPUT_HAS_WRITE
+  const char *next = bytes;
+  while(size > 0) {
+    ssize_t written = write(STDOUT_FILENO, next, size);
+    if(written < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    next += written;
+    size -= (size_t) written;
+  }
+#else
+  fwrite(bytes, size, 1, stdout);
+  fflush(stdout);
+#endif
+}
+
+void ryvm_output_flush(struct ryvm_output *out) {
+  if(out->length == 0) {
+    return;
+  }
+  ryvm_output_write_direct(out->buffer, out->length);
+  out->length = 0;
+}
+
+void ryvm_output_write(struct ryvm_output *out, const void *bytes, size_t size) {
+  if(size > RYVM_OUTPUT_BUFFER_SIZE - out->length) {
+    ryvm_output_flush(out);
+
+    //no point in copying a write this large into the buffer
+    if(size >= RYVM_OUTPUT_BUFFER_SIZE) {
+      ryvm_output_write_direct(bytes, size);
+      return;
+    }
+  }
+
+  if(out->buffer == NULL) {
+    out->buffer = malloc(RYVM_OUTPUT_BUFFER_SIZE);
+    if(out->buffer == NULL) {
+      ryvm_output_write_direct(bytes, size);
+      return;
+    }
+  }
+
+  memcpy(out->buffer + out->length, bytes, size);
+  out->length += size;
+}
+
+//convert value to base 10, writing the digits backwards from end.
+//Returns a pointer to the first digit.
+static char* ryvm_output_format_u64(char *end, uint64_t value) {
+  while(value >= 100) {
+    const char *pair = ryvm_output_digit_pairs + (value % 100) * 2;
+    value /= 100;
+    *--end = pair[1];
+    *--end = pair[0];
+  }
+
+  if(value >= 10) {
+    const char *pair = ryvm_output_digit_pairs + value * 2;
+    *--end = pair[1];
+    *--end = pair[0];
+  } else {
+    *--end = (char) ('0' + value);
+  }
+
+  return end;
+}
+
+void ryvm_output_write_u64(struct ryvm_output *out, uint64_t value) {
+  char digits[RYVM_OUTPUT_MAX_INT_DIGITS];
+  char *end = digits + sizeof(digits);
+  char *start = ryvm_output_format_u64(end, value);
+  ryvm_output_write(out, start, (size_t) (end - start));
+}
+
+void ryvm_output_write_i64(struct ryvm_output *out, int64_t value) {
+  char digits[RYVM_OUTPUT_MAX_INT_DIGITS];
+  char *end = digits + sizeof(digits);
+
+  //negate as unsigned so that INT64_MIN does not overflow
+  uint64_t magnitude = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+  char *start = ryvm_output_format_u64(end, magnitude);
+  if(value < 0) {
+    *--start = '-';
+  }
+  ryvm_output_write(out, start, (size_t) (end - start));
+}
+
+void ryvm_output_write_f64(struct ryvm_output *out, double value) {
+  char digits[32];
+  int length = snprintf(digits, sizeof(digits), "%.17g", value);
+  if(length > 0) {
+    ryvm_output_write(out, digits, (size_t) length);
+  }
+}
+
+void ryvm_output_free(struct ryvm_output *out) {
+  ryvm_output_flush(out);
+  free(out->buffer);
+  out->buffer = NULL;
+}
@@ -0,0 +1,38 @@
+#ifndef RYVM_OUTPUT_H
+#define RYVM_OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//number of bytes buffered before the output is written to the OS
+#define RYVM_OUTPUT_BUFFER_SIZE (64 * 1024)
+
+//buffers the output of a guest program so that many small writes turn into 
+//a few large writes to standard output.
+struct ryvm_output {
+  char *buffer; //allocated on the first write
+  size_t length;
+};
+
+void ryvm_output_init(struct ryvm_output *out);
+
+//append bytes to the buffer. Writes that do not fit are flushed first, and writes larger
+//than the buffer skip it completely.
+void ryvm_output_write(struct ryvm_output *out, const void *bytes, size_t size);
+
+//append a number in base 10 to the buffer, without using printf
+void ryvm_output_write_u64(struct ryvm_output *out, uint64_t value);
+void ryvm_output_write_i64(struct ryvm_output *out, int64_t value);
+
+//append a floating point number with enough digits to read it back exactly
+void ryvm_output_write_f64(struct ryvm_output *out, double value);
+
+//write everything in the buffer to standard output. Anything buffered by stdio is flushed first,
+//so output from printf and the buffer stays in order.
+void ryvm_output_flush(struct ryvm_output *out);
+
+//flush the buffer and free it
+void ryvm_output_free(struct ryvm_output *out);
+
+
+#endif // RYVM_OUTPUT_H
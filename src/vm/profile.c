@@ -0,0 +1,125 @@
+#include "profile.h"
+#include "../helper.h"
+#include "../opcodes.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+struct ryvm_profile_block {
+  uint64_t start;    //offset of the first instruction
+  uint64_t end;      //offset after the last instruction
+  uint64_t runs;     //the number of times the block was entered
+  uint64_t executed; //the number of instructions run inside the block
+};
+
+int ryvm_profile_init(struct ryvm_profile *profile, uint64_t text_size) {
+  profile->text_size = text_size;
+  profile->counts = calloc(text_size == 0 ? 1 : text_size, sizeof(uint64_t));
+  return profile->counts != NULL;
+}
+
+static int ryvm_profile_compare_blocks(const void *a, const void *b) {
+  const struct ryvm_profile_block *x = a;
+  const struct ryvm_profile_block *y = b;
+  if(x->executed != y->executed) {
+    return x->executed < y->executed ? 1 : -1;
+  }
+  return (x->start > y->start) - (x->start < y->start);
+}
+
+//print the label and source lines of a block
+static void ryvm_profile_print_location(const struct ryvm_profile_block *block, const struct ryvm_symbols *symbols) {
+  const struct ryvm_symbol *label = ryvm_symbols_find_label(symbols, block->start);
+  if(label != NULL) {
+    printf("%s+%llu", label->name, (unsigned long long) (block->start - label->offset));
+  } else {
+    printf("text+%llu", (unsigned long long) block->start);
+  }
+
+  uint32_t first_line = 0;
+  uint32_t last_line = 0;
+  for(uint64_t offset = block->start; offset < block->end; offset += RYVM_INS_SIZE) {
+    uint32_t line = ryvm_symbols_find_line(symbols, offset);
+    if(line != 0 && (first_line == 0 || line < first_line)) {
+      first_line = line;
+    }
+    if(line > last_line) {
+      last_line = line;
+    }
+  }
+
+  if(first_line == last_line && first_line != 0) {
+    printf(" (line %u)", first_line);
+  } else if(first_line != 0) {
+    printf(" (lines %u-%u)", first_line, last_line);
+  }
+}
+
+void ryvm_profile_report(const struct ryvm_profile *profile, const uint8_t *text, const struct ryvm_symbols *symbols, uint32_t max_blocks) {
+  //every instruction is at least 4 bytes long, so there cannot be more blocks than this
+  uint64_t max_num_blocks = profile->text_size / RYVM_INS_SIZE + 1;
+  struct ryvm_profile_block *blocks = malloc(max_num_blocks * sizeof(struct ryvm_profile_block));
+  if(blocks == NULL) {
+    printf("Cannot allocate memory for the profile report!\n");
+    return;
+  }
+
+  uint64_t num_blocks = 0;
+  uint64_t total = 0;
+  uint64_t next_label = 0;
+  uint8_t after_jump = 1;
+
+  //only offsets where an instruction started running are looked at, so raw data and
+  //the extension words of wide immediates are skipped without having to be decoded
+  for(uint64_t offset = 0; offset < profile->text_size; offset++) {
+    uint64_t count = profile->counts[offset];
+    if(count == 0) {
+      continue;
+    }
+
+    uint8_t at_label = 0;
+    while(next_label < symbols->num_labels && symbols->labels[next_label].offset <= offset) {
+      at_label |= symbols->labels[next_label].offset == offset;
+      next_label++;
+    }
+
+    //running out of blocks is only possible if the program jumped into the middle of an instruction
+    uint8_t new_block = after_jump || at_label || offset != blocks[num_blocks - 1].end || count != blocks[num_blocks - 1].runs;
+    if(new_block && num_blocks < max_num_blocks) {
+      blocks[num_blocks].start = offset;
+      blocks[num_blocks].runs = count;
+      blocks[num_blocks].executed = 0;
+      num_blocks++;
+    }
+
+    enum ryvm_opcode op = (enum ryvm_opcode) text[offset];
+    blocks[num_blocks - 1].executed += count;
+    blocks[num_blocks - 1].end = offset + RYVM_INS_SIZE + ryvm_opcode_ext_size(op);
+    total += count;
+
+    after_jump = ryvm_opcode_is_jump(op);
+  }
+
+  //a block ending inside the last instruction is cut off at the end of the text section
+  if(num_blocks > 0 && blocks[num_blocks - 1].end > profile->text_size) {
+    blocks[num_blocks - 1].end = profile->text_size;
+  }
+
+  qsort(blocks, num_blocks, sizeof(struct ryvm_profile_block), ryvm_profile_compare_blocks);
+
+  printf("Profile: %llu instructions executed\n", (unsigned long long) total);
+  printf("%14s %7s %12s  %s\n", "instructions", "share", "runs", "block");
+  for(uint64_t i = 0; i < num_blocks && i < max_blocks && blocks[i].executed > 0; i++) {
+    double share = 100.0 * (double) blocks[i].executed / (double) total;
+    printf("%14llu %6.2f%% %12llu  ", (unsigned long long) blocks[i].executed, share, (unsigned long long) blocks[i].runs);
+    ryvm_profile_print_location(&blocks[i], symbols);
+    printf("\n");
+  }
+
+  free(blocks);
+}
+
+void ryvm_profile_free(struct ryvm_profile *profile) {
+  free(profile->counts);
+  profile->counts = NULL;
+  profile->text_size = 0;
+}
@@ -0,0 +1,30 @@
+#ifndef RYVM_PROFILE_H
+#define RYVM_PROFILE_H
+
+#include <stdint.h>
+#include "symbols.h"
+
+//the number of basic blocks ryvm --profile prints
+#define RYVM_PROFILE_REPORT_BLOCKS 20
+
+//Execution counters for ryvm --profile. Point vm->profile at one before calling ryvm_vm_run to enable it.
+//The VM has a separate copy of its dispatch loop for profiling, so the counters cost nothing when disabled.
+//Only the thread that calls ryvm_vm_run is counted (including its fibers), spawned threads are not.
+struct ryvm_profile {
+  //the number of times the instruction starting at each byte of the text section ran. Raw data in the text
+  //section does not have to be a multiple of 4 bytes, so instructions are not always 4-byte aligned.
+  uint64_t *counts;
+  uint64_t text_size;
+};
+
+int ryvm_profile_init(struct ryvm_profile *profile, uint64_t text_size);
+
+//print the basic blocks that ran the most instructions, described using the symbol table if there is one.
+//Blocks start at labels, after jumps, after anything that did not run, and wherever the count of an instruction
+//differs from the one before it. Only instructions that ran are reported, so raw data never shows up as a block.
+void ryvm_profile_report(const struct ryvm_profile *profile, const uint8_t *text, const struct ryvm_symbols *symbols, uint32_t max_blocks);
+
+void ryvm_profile_free(struct ryvm_profile *profile);
+
+
+#endif // RYVM_PROFILE_H
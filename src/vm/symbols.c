@@ -0,0 +1,132 @@
+#include "symbols.h"
+#include <stdlib.h>
+#include <string.h>
+
+void ryvm_symbols_init(struct ryvm_symbols *symbols) {
+  symbols->labels = NULL;
+  symbols->num_labels = 0;
+  symbols->lines = NULL;
+  symbols->num_lines = 0;
+}
+
+static int ryvm_symbols_compare_labels(const void *a, const void *b) {
+  const struct ryvm_symbol *x = a;
+  const struct ryvm_symbol *y = b;
+  return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+static int ryvm_symbols_compare_lines(const void *a, const void *b) {
+  const struct ryvm_symbol_line *x = a;
+  const struct ryvm_symbol_line *y = b;
+  return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+size_t ryvm_symbols_read(struct ryvm_symbols *symbols, const uint8_t *bytes, size_t size) {
+  size_t read = 0;
+  uint64_t num_labels;
+  if(size < 8) {
+    return 0;
+  }
+  memcpy(&num_labels, bytes, 8);
+  read += 8;
+
+  //every label takes at least 9 bytes (its offset and the null terminator)
+  if(num_labels > (size - read) / 9) {
+    return 0;
+  }
+  symbols->labels = calloc(num_labels == 0 ? 1 : num_labels, sizeof(struct ryvm_symbol));
+  if(symbols->labels == NULL) {
+    return 0;
+  }
+
+  for(uint64_t i = 0; i < num_labels; i++) {
+    if(read + 8 > size) {
+      goto fail;
+    }
+    memcpy(&symbols->labels[i].offset, bytes + read, 8);
+    read += 8;
+
+    const uint8_t *end = memchr(bytes + read, 0, size - read);
+    if(end == NULL) {
+      goto fail;
+    }
+    size_t length = end - (bytes + read);
+    symbols->labels[i].name = malloc(length + 1);
+    if(symbols->labels[i].name == NULL) {
+      goto fail;
+    }
+    memcpy(symbols->labels[i].name, bytes + read, length + 1);
+    symbols->num_labels++;
+    read += length + 1;
+  }
+
+  uint64_t num_lines;
+  if(read + 8 > size) {
+    goto fail;
+  }
+  memcpy(&num_lines, bytes + read, 8);
+  read += 8;
+  if(num_lines > (size - read) / 12) {
+    goto fail;
+  }
+
+  symbols->lines = malloc((num_lines == 0 ? 1 : num_lines) * sizeof(struct ryvm_symbol_line));
+  if(symbols->lines == NULL) {
+    goto fail;
+  }
+  for(uint64_t i = 0; i < num_lines; i++) {
+    memcpy(&symbols->lines[i].offset, bytes + read, 8);
+    memcpy(&symbols->lines[i].line, bytes + read + 8, 4);
+    read += 12;
+  }
+  symbols->num_lines = num_lines;
+
+  qsort(symbols->labels, symbols->num_labels, sizeof(struct ryvm_symbol), ryvm_symbols_compare_labels);
+  qsort(symbols->lines, symbols->num_lines, sizeof(struct ryvm_symbol_line), ryvm_symbols_compare_lines);
+  return read;
+
+  fail:
+  ryvm_symbols_free(symbols);
+  return 0;
+}
+
+const struct ryvm_symbol* ryvm_symbols_find_label(const struct ryvm_symbols *symbols, uint64_t offset) {
+  //find the first label after offset, the label before it is the one we want
+  uint64_t low = 0;
+  uint64_t high = symbols->num_labels;
+  while(low < high) {
+    uint64_t mid = low + (high - low) / 2;
+    if(symbols->labels[mid].offset <= offset) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low == 0 ? NULL : &symbols->labels[low - 1];
+}
+
+uint32_t ryvm_symbols_find_line(const struct ryvm_symbols *symbols, uint64_t offset) {
+  uint64_t low = 0;
+  uint64_t high = symbols->num_lines;
+  while(low < high) {
+    uint64_t mid = low + (high - low) / 2;
+    if(symbols->lines[mid].offset == offset) {
+      return symbols->lines[mid].line;
+    }
+    if(symbols->lines[mid].offset < offset) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return 0;
+}
+
+void ryvm_symbols_free(struct ryvm_symbols *symbols) {
+  for(uint64_t i = 0; i < symbols->num_labels; i++) {
+    free(symbols->labels[i].name);
+  }
+  free(symbols->labels);
+  free(symbols->lines);
+  ryvm_symbols_init(symbols);
+}
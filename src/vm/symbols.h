@@ -0,0 +1,43 @@
+#ifndef RYVM_SYMBOLS_H
+#define RYVM_SYMBOLS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//The symbol table written by the assembler when it is given -g (see RYVM_ASSEMBLER_FLAG_SYMBOLS).
+//It is only used to describe addresses to the user, so the VM runs the same with or without it.
+//All offsets are relative to the start of the text section.
+
+struct ryvm_symbol {
+  uint64_t offset;
+  char *name;
+};
+
+struct ryvm_symbol_line {
+  uint64_t offset; //offset of an instruction
+  uint32_t line;   //the line of the source file it came from
+};
+
+struct ryvm_symbols {
+  struct ryvm_symbol *labels; //sorted by offset
+  uint64_t num_labels;
+
+  struct ryvm_symbol_line *lines; //sorted by offset
+  uint64_t num_lines;
+};
+
+void ryvm_symbols_init(struct ryvm_symbols *symbols);
+
+//read a symbol table stored in bytes. Returns the number of bytes read, or 0 if the table is invalid.
+size_t ryvm_symbols_read(struct ryvm_symbols *symbols, const uint8_t *bytes, size_t size);
+
+//returns the label at or before offset, or NULL if there is none.
+const struct ryvm_symbol* ryvm_symbols_find_label(const struct ryvm_symbols *symbols, uint64_t offset);
+
+//returns the source line of the instruction at offset, or 0 if it is unknown.
+uint32_t ryvm_symbols_find_line(const struct ryvm_symbols *symbols, uint64_t offset);
+
+void ryvm_symbols_free(struct ryvm_symbols *symbols);
+
+
+#endif // RYVM_SYMBOLS_H
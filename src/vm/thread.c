@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread.h"
+#include "vm.h"
+#include "../helper.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <pthread.h>
+  #define RYVM_THREAD_SUPPORTED 1
+#else
+  #define RYVM_THREAD_SUPPORTED 0
+#endif
+
+
+#if RYVM_THREAD_SUPPORTED
+
+struct ryvm_thread {
+  pthread_t handle;
+  struct ryvm vm;
+  int64_t result;
+};
+
+//threads start with their link register pointing here, so returning from the 
+//entry function ends the thread with W0 as the result.
+static const uint8_t ryvm_thread_exit_ins[RYVM_INS_SIZE] = {RYVM_OP_SYS, 0, 0, 0};
+
+static void* ryvm_thread_main(void *arg) {
+  struct ryvm_thread *thread = arg;
+  thread->result = ryvm_vm_execute(&thread->vm);
+  return NULL;
+}
+
+int ryvm_thread_spawn(struct ryvm *vm, uint64_t entry, uint64_t stack_size, uint64_t arg, uint64_t *id) {
+  uint8_t slot = 0;
+  while(slot < RYVM_VM_MAX_THREADS && vm->threads[slot] != NULL) {
+    slot++;
+  }
+  if(slot == RYVM_VM_MAX_THREADS) {
+    return 0;
+  }
+
+  if(stack_size == 0) {
+    stack_size = RYVM_THREAD_DEFAULT_STACK_SIZE;
+  }
+
+  struct ryvm_thread *thread = malloc(sizeof(struct ryvm_thread));
+  if(thread == NULL) {
+    return 0;
+  }
+
+  struct ryvm *child = &thread->vm;
+  ryvm_vm_init(child);
+
+  //share the program with the parent instead of loading it again
+  child->data_and_code = vm->data_and_code;
+  child->data_and_code_size = vm->data_and_code_size;
+  child->text_section_start = vm->text_section_start;
+  child->owns_data_and_code = 0;
+
+  //the parent keeps ownership of its channels, and outlives the thread since it joins it before being freed
+  for(uint8_t i = 0; i < vm->num_channels; i++) {
+    child->channels[i] = vm->channels[i];
+  }
+  child->num_channels = vm->num_channels;
+
+  child->stack = malloc(stack_size);
+  if(child->stack == NULL) {
+    free(thread);
+    return 0;
+  }
+  child->stack_size = stack_size;
+
+  memset(child->gen_registers, 0, sizeof(child->main_registers));
+  child->gen_registers[0] = arg;
+  child->gen_registers[RYVM_PC_REG] = entry;
+  child->gen_registers[RYVM_SP_REG] = (uint64_t) child->stack;
+  child->gen_registers[RYVM_FP_REG] = (uint64_t) child->stack;
+  child->gen_registers[RYVM_LR_REG] = (uint64_t) ryvm_thread_exit_ins;
+
+  if(pthread_create(&thread->handle, NULL, ryvm_thread_main, thread) != 0) {
+    ryvm_vm_free(child);
+    free(thread);
+    return 0;
+  }
+
+  vm->threads[slot] = thread;
+  *id = slot;
+  return 1;
+}
+
+int ryvm_thread_join(struct ryvm *vm, uint64_t id, uint64_t *result) {
+  if(id >= RYVM_VM_MAX_THREADS || vm->threads[id] == NULL) {
+    return 0;
+  }
+
+  struct ryvm_thread *thread = vm->threads[id];
+  pthread_join(thread->handle, NULL);
+  *result = (uint64_t) thread->result;
+
+  ryvm_vm_free(&thread->vm);
+  free(thread);
+  vm->threads[id] = NULL;
+  return 1;
+}
+
+#else
+
+//without pthreads, spawning a thread always fails
+
+int ryvm_thread_spawn(struct ryvm *vm, uint64_t entry, uint64_t stack_size, uint64_t arg, uint64_t *id) {
+  (void) vm;
+  (void) entry;
+  (void) stack_size;
+  (void) arg;
+  (void) id;
+  return 0;
+}
+
+int ryvm_thread_join(struct ryvm *vm, uint64_t id, uint64_t *result) {
+  (void) vm;
+  (void) id;
+  (void) result;
+  return 0;
+}
+
+#endif
+
+void ryvm_thread_join_all(struct ryvm *vm) {
+  uint64_t result;
+  for(uint64_t i = 0; i < RYVM_VM_MAX_THREADS; i++) {
+    ryvm_thread_join(vm, i, &result);
+  }
+}
@@ -0,0 +1,29 @@
+#ifndef RYVM_THREAD_H
+#define RYVM_THREAD_H
+
+#include <stdint.h>
+
+//the max number of threads a VM can have running (or waiting to be joined) at once
+#define RYVM_VM_MAX_THREADS 64
+
+//stack size used when a guest spawns a thread with a stack size of 0
+#define RYVM_THREAD_DEFAULT_STACK_SIZE (1024 * 1024)
+
+struct ryvm;
+
+//a host thread running a guest function in its own VM. The VM shares the data and text
+//sections of its parent, but has its own registers, stack, and output buffer.
+struct ryvm_thread;
+
+//start a host thread at the instruction at entry, with its argument in W0. 
+//Returns 0 if the thread cannot be started.
+int ryvm_thread_spawn(struct ryvm *vm, uint64_t entry, uint64_t stack_size, uint64_t arg, uint64_t *id);
+
+//wait for a thread to finish and free it. Returns 0 if there is no thread with that id.
+int ryvm_thread_join(struct ryvm *vm, uint64_t id, uint64_t *result);
+
+//wait for every thread that was never joined
+void ryvm_thread_join_all(struct ryvm *vm);
+
+
+#endif // RYVM_THREAD_H
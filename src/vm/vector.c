@@ -0,0 +1,273 @@
+#include "vector.h"
+#include <stdlib.h>
+#include <string.h>
+
+//SSE2 is part of the base x86-64 instruction set, so it only needs to be detected on 32-bit x86.
+//AVX2 functions are compiled with a target attribute, so the rest of the VM does not need -mavx2.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  #include <immintrin.h>
+  #define RYVM_VECTOR_X86 1
+#else
+  #define RYVM_VECTOR_X86 0
+#endif
+
+
+// Scalar
+
+//the lanes are copied into local arrays first, since the register file and memory
+//are not guaranteed to be aligned to the lane type.
+#define RYVM_VECTOR_SCALAR(name, type, expr) \
+static void name(uint8_t *dest, const uint8_t *a, const uint8_t *b) { \
+  type x[RYVM_VECTOR_BYTES / sizeof(type)]; \
+  type y[RYVM_VECTOR_BYTES / sizeof(type)]; \
+  memcpy(x, a, RYVM_VECTOR_BYTES); \
+  memcpy(y, b, RYVM_VECTOR_BYTES); \
+  for(size_t i = 0; i < RYVM_VECTOR_BYTES / sizeof(type); i++) { \
+    x[i] = (type) (expr); \
+  } \
+  memcpy(dest, x, RYVM_VECTOR_BYTES); \
+}
+
+//multiplying in uint64_t avoids signed overflow when small unsigned types are promoted to int
+#define RYVM_VECTOR_SCALAR_INT(bits) \
+RYVM_VECTOR_SCALAR(ryvm_vector_scalar_add##bits, uint##bits##_t, x[i] + y[i]) \
+RYVM_VECTOR_SCALAR(ryvm_vector_scalar_sub##bits, uint##bits##_t, x[i] - y[i]) \
+RYVM_VECTOR_SCALAR(ryvm_vector_scalar_mul##bits, uint##bits##_t, (uint64_t) x[i] * y[i]) \
+RYVM_VECTOR_SCALAR(ryvm_vector_scalar_cmpeq##bits, uint##bits##_t, x[i] == y[i] ? UINT##bits##_MAX : 0) \
+RYVM_VECTOR_SCALAR(ryvm_vector_scalar_cmpgt##bits, int##bits##_t, x[i] > y[i] ? -1 : 0)
+
+RYVM_VECTOR_SCALAR_INT(8)
+RYVM_VECTOR_SCALAR_INT(16)
+RYVM_VECTOR_SCALAR_INT(32)
+RYVM_VECTOR_SCALAR_INT(64)
+
+RYVM_VECTOR_SCALAR(ryvm_vector_scalar_addf32, float, x[i] + y[i])
+RYVM_VECTOR_SCALAR(ryvm_vector_scalar_subf32, float, x[i] - y[i])
+RYVM_VECTOR_SCALAR(ryvm_vector_scalar_mulf32, float, x[i] * y[i])
+RYVM_VECTOR_SCALAR(ryvm_vector_scalar_addf64, double, x[i] + y[i])
+RYVM_VECTOR_SCALAR(ryvm_vector_scalar_subf64, double, x[i] - y[i])
+RYVM_VECTOR_SCALAR(ryvm_vector_scalar_mulf64, double, x[i] * y[i])
+
+static const struct ryvm_vector_impl ryvm_vector_scalar = {
+  .name = "scalar",
+  .add = {ryvm_vector_scalar_add8, ryvm_vector_scalar_add16, ryvm_vector_scalar_add32, ryvm_vector_scalar_add64},
+  .sub = {ryvm_vector_scalar_sub8, ryvm_vector_scalar_sub16, ryvm_vector_scalar_sub32, ryvm_vector_scalar_sub64},
+  .mul = {ryvm_vector_scalar_mul8, ryvm_vector_scalar_mul16, ryvm_vector_scalar_mul32, ryvm_vector_scalar_mul64},
+  .cmpeq = {ryvm_vector_scalar_cmpeq8, ryvm_vector_scalar_cmpeq16, ryvm_vector_scalar_cmpeq32, ryvm_vector_scalar_cmpeq64},
+  .cmpgt = {ryvm_vector_scalar_cmpgt8, ryvm_vector_scalar_cmpgt16, ryvm_vector_scalar_cmpgt32, ryvm_vector_scalar_cmpgt64},
+  .addf = {ryvm_vector_scalar_addf32, ryvm_vector_scalar_addf64},
+  .subf = {ryvm_vector_scalar_subf32, ryvm_vector_scalar_subf64},
+  .mulf = {ryvm_vector_scalar_mulf32, ryvm_vector_scalar_mulf64},
+};
+
+
+#if RYVM_VECTOR_X86
+
+// SSE2
+
+//a 256-bit vector register is processed as two 128-bit halves
+#define RYVM_VECTOR_SSE2(name, vtype, load, store, intrinsic) \
+static void name(uint8_t *dest, const uint8_t *a, const uint8_t *b) { \
+  for(size_t i = 0; i < RYVM_VECTOR_BYTES; i += 16) { \
+    vtype x = load((const void*) (a + i)); \
+    vtype y = load((const void*) (b + i)); \
+    store((void*) (dest + i), intrinsic(x, y)); \
+  } \
+}
+
+#define RYVM_VECTOR_SSE2_INT(name, intrinsic) \
+  RYVM_VECTOR_SSE2(name, __m128i, _mm_loadu_si128, _mm_storeu_si128, intrinsic)
+
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_add8, _mm_add_epi8)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_add16, _mm_add_epi16)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_add32, _mm_add_epi32)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_add64, _mm_add_epi64)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_sub8, _mm_sub_epi8)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_sub16, _mm_sub_epi16)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_sub32, _mm_sub_epi32)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_sub64, _mm_sub_epi64)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_mul16, _mm_mullo_epi16)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_cmpeq8, _mm_cmpeq_epi8)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_cmpeq16, _mm_cmpeq_epi16)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_cmpeq32, _mm_cmpeq_epi32)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_cmpgt8, _mm_cmpgt_epi8)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_cmpgt16, _mm_cmpgt_epi16)
+RYVM_VECTOR_SSE2_INT(ryvm_vector_sse2_cmpgt32, _mm_cmpgt_epi32)
+
+RYVM_VECTOR_SSE2(ryvm_vector_sse2_addf32, __m128, _mm_loadu_ps, _mm_storeu_ps, _mm_add_ps)
+RYVM_VECTOR_SSE2(ryvm_vector_sse2_subf32, __m128, _mm_loadu_ps, _mm_storeu_ps, _mm_sub_ps)
+RYVM_VECTOR_SSE2(ryvm_vector_sse2_mulf32, __m128, _mm_loadu_ps, _mm_storeu_ps, _mm_mul_ps)
+RYVM_VECTOR_SSE2(ryvm_vector_sse2_addf64, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm_add_pd)
+RYVM_VECTOR_SSE2(ryvm_vector_sse2_subf64, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm_sub_pd)
+RYVM_VECTOR_SSE2(ryvm_vector_sse2_mulf64, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm_mul_pd)
+
+//SSE2 has no 8, 32, or 64-bit multiply and no 64-bit compares, so those lanes use the scalar versions
+static const struct ryvm_vector_impl ryvm_vector_sse2 = {
+  .name = "sse2",
+  .add = {ryvm_vector_sse2_add8, ryvm_vector_sse2_add16, ryvm_vector_sse2_add32, ryvm_vector_sse2_add64},
+  .sub = {ryvm_vector_sse2_sub8, ryvm_vector_sse2_sub16, ryvm_vector_sse2_sub32, ryvm_vector_sse2_sub64},
+  .mul = {ryvm_vector_scalar_mul8, ryvm_vector_sse2_mul16, ryvm_vector_scalar_mul32, ryvm_vector_scalar_mul64},
+  .cmpeq = {ryvm_vector_sse2_cmpeq8, ryvm_vector_sse2_cmpeq16, ryvm_vector_sse2_cmpeq32, ryvm_vector_scalar_cmpeq64},
+  .cmpgt = {ryvm_vector_sse2_cmpgt8, ryvm_vector_sse2_cmpgt16, ryvm_vector_sse2_cmpgt32, ryvm_vector_scalar_cmpgt64},
+  .addf = {ryvm_vector_sse2_addf32, ryvm_vector_sse2_addf64},
+  .subf = {ryvm_vector_sse2_subf32, ryvm_vector_sse2_subf64},
+  .mulf = {ryvm_vector_sse2_mulf32, ryvm_vector_sse2_mulf64},
+};
+
+
+// AVX2
+
+#define RYVM_VECTOR_AVX2(name, vtype, load, store, intrinsic) \
+__attribute__((target("avx2"))) \
+static void name(uint8_t *dest, const uint8_t *a, const uint8_t *b) { \
+  vtype x = load((const void*) a); \
+  vtype y = load((const void*) b); \
+  store((void*) dest, intrinsic(x, y)); \
+}
+
+#define RYVM_VECTOR_AVX2_INT(name, intrinsic) \
+  RYVM_VECTOR_AVX2(name, __m256i, _mm256_loadu_si256, _mm256_storeu_si256, intrinsic)
+
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_add8, _mm256_add_epi8)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_add16, _mm256_add_epi16)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_add32, _mm256_add_epi32)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_add64, _mm256_add_epi64)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_sub8, _mm256_sub_epi8)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_sub16, _mm256_sub_epi16)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_sub32, _mm256_sub_epi32)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_sub64, _mm256_sub_epi64)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_mul16, _mm256_mullo_epi16)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_mul32, _mm256_mullo_epi32)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_cmpeq8, _mm256_cmpeq_epi8)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_cmpeq16, _mm256_cmpeq_epi16)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_cmpeq32, _mm256_cmpeq_epi32)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_cmpeq64, _mm256_cmpeq_epi64)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_cmpgt8, _mm256_cmpgt_epi8)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_cmpgt16, _mm256_cmpgt_epi16)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_cmpgt32, _mm256_cmpgt_epi32)
+RYVM_VECTOR_AVX2_INT(ryvm_vector_avx2_cmpgt64, _mm256_cmpgt_epi64)
+
+RYVM_VECTOR_AVX2(ryvm_vector_avx2_addf32, __m256, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_add_ps)
+RYVM_VECTOR_AVX2(ryvm_vector_avx2_subf32, __m256, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_sub_ps)
+RYVM_VECTOR_AVX2(ryvm_vector_avx2_mulf32, __m256, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_mul_ps)
+RYVM_VECTOR_AVX2(ryvm_vector_avx2_addf64, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd)
+RYVM_VECTOR_AVX2(ryvm_vector_avx2_subf64, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_sub_pd)
+RYVM_VECTOR_AVX2(ryvm_vector_avx2_mulf64, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd)
+
+//AVX2 has no 8 or 64-bit multiply
+static const struct ryvm_vector_impl ryvm_vector_avx2 = {
+  .name = "avx2",
+  .add = {ryvm_vector_avx2_add8, ryvm_vector_avx2_add16, ryvm_vector_avx2_add32, ryvm_vector_avx2_add64},
+  .sub = {ryvm_vector_avx2_sub8, ryvm_vector_avx2_sub16, ryvm_vector_avx2_sub32, ryvm_vector_avx2_sub64},
+  .mul = {ryvm_vector_scalar_mul8, ryvm_vector_avx2_mul16, ryvm_vector_avx2_mul32, ryvm_vector_scalar_mul64},
+  .cmpeq = {ryvm_vector_avx2_cmpeq8, ryvm_vector_avx2_cmpeq16, ryvm_vector_avx2_cmpeq32, ryvm_vector_avx2_cmpeq64},
+  .cmpgt = {ryvm_vector_avx2_cmpgt8, ryvm_vector_avx2_cmpgt16, ryvm_vector_avx2_cmpgt32, ryvm_vector_avx2_cmpgt64},
+  .addf = {ryvm_vector_avx2_addf32, ryvm_vector_avx2_addf64},
+  .subf = {ryvm_vector_avx2_subf32, ryvm_vector_avx2_subf64},
+  .mulf = {ryvm_vector_avx2_mulf32, ryvm_vector_avx2_mulf64},
+};
+
+#endif
+
+
+const struct ryvm_vector_impl* ryvm_vector_select(void) {
+  const char *forced = getenv("RYVM_VECTOR");
+
+#if RYVM_VECTOR_X86
+  __builtin_cpu_init();
+  uint8_t has_avx2 = __builtin_cpu_supports("avx2") != 0;
+  uint8_t has_sse2 = __builtin_cpu_supports("sse2") != 0;
+
+  if(forced != NULL && strcmp(forced, "scalar") == 0) {
+    return &ryvm_vector_scalar;
+  }
+  if(forced != NULL && strcmp(forced, "sse2") == 0 && has_sse2) {
+    return &ryvm_vector_sse2;
+  }
+  if(has_avx2) {
+    return &ryvm_vector_avx2;
+  }
+  if(has_sse2) {
+    return &ryvm_vector_sse2;
+  }
+#else
+  (void) forced;
+#endif
+
+  return &ryvm_vector_scalar;
+}
+
+
+uint8_t ryvm_vector_lane_index(uint8_t bytewidth) {
+  switch(bytewidth) {
+    case 1: return 0;
+    case 2: return 1;
+    case 4: return 2;
+    default: return 3;
+  }
+}
+
+//only 32 and 64-bit float lanes are supported, every other width is treated as 32 bits
+uint8_t ryvm_vector_float_index(uint8_t bytewidth) {
+  return bytewidth == 8 ? 1 : 0;
+}
+
+
+//read lane i of src, zero-extended to 64 bits
+static uint64_t ryvm_vector_get_lane(const uint8_t *src, size_t i, uint8_t lane_bytewidth) {
+  switch(lane_bytewidth) {
+    case 1: { uint8_t v; memcpy(&v, src + i, 1); return v; }
+    case 2: { uint16_t v; memcpy(&v, src + i * 2, 2); return v; }
+    case 4: { uint32_t v; memcpy(&v, src + i * 4, 4); return v; }
+    default: { uint64_t v; memcpy(&v, src + i * 8, 8); return v; }
+  }
+}
+
+
+uint64_t ryvm_vector_reduce_add(const uint8_t *src, uint8_t lane_bytewidth) {
+  uint64_t sum = 0;
+  for(size_t i = 0; i < RYVM_VECTOR_BYTES / lane_bytewidth; i++) {
+    sum += ryvm_vector_get_lane(src, i, lane_bytewidth);
+  }
+  return sum;
+}
+
+
+uint64_t ryvm_vector_reduce_addf(const uint8_t *src, uint8_t lane_bytewidth) {
+  uint64_t result = 0;
+  if(ryvm_vector_float_index(lane_bytewidth) == 1) {
+    double lanes[RYVM_VECTOR_BYTES / sizeof(double)];
+    double sum = 0;
+    memcpy(lanes, src, RYVM_VECTOR_BYTES);
+    for(size_t i = 0; i < RYVM_VECTOR_BYTES / sizeof(double); i++) {
+      sum += lanes[i];
+    }
+    memcpy(&result, &sum, sizeof(sum));
+  } else {
+    float lanes[RYVM_VECTOR_BYTES / sizeof(float)];
+    float sum = 0;
+    memcpy(lanes, src, RYVM_VECTOR_BYTES);
+    for(size_t i = 0; i < RYVM_VECTOR_BYTES / sizeof(float); i++) {
+      sum += lanes[i];
+    }
+    memcpy(&result, &sum, sizeof(sum));
+  }
+  return result;
+}
+
+
+void ryvm_vector_dup(uint8_t *dest, uint64_t value, uint8_t lane_bytewidth) {
+  for(size_t i = 0; i < RYVM_VECTOR_BYTES; i += lane_bytewidth) {
+    memcpy(dest + i, &value, lane_bytewidth);
+  }
+}
+
+
+uint64_t ryvm_vector_mask(const uint8_t *src, uint8_t lane_bytewidth) {
+  uint64_t mask = 0;
+  for(size_t i = 0; i < RYVM_VECTOR_BYTES / lane_bytewidth; i++) {
+    //on a little endian host, the most significant byte of a lane is its last byte
+    mask |= (uint64_t) (src[i * lane_bytewidth + lane_bytewidth - 1] >> 7) << i;
+  }
+  return mask;
+}
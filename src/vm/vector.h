@@ -0,0 +1,51 @@
+#ifndef RYVM_VECTOR_H
+#define RYVM_VECTOR_H
+
+#include <stdint.h>
+
+#define RYVM_VECTOR_NUM_REGISTERS 32
+#define RYVM_VECTOR_BYTES 32 //each vector register is 256 bits
+
+//applies an operation to every lane of a and b, storing the lanes in dest. 
+//All 3 pointers point to RYVM_VECTOR_BYTES bytes, and do not need to be aligned.
+typedef void (*ryvm_vector_binary_fn)(uint8_t *dest, const uint8_t *a, const uint8_t *b);
+
+//Each operation has one function per lane width. Integer functions are indexed by
+//log2 of the lane bytewidth (0 = 8 bits, 3 = 64 bits), and float functions are indexed
+//by 0 for 32-bit floats and 1 for 64-bit floats.
+struct ryvm_vector_impl {
+  const char *name;
+
+  ryvm_vector_binary_fn add[4];
+  ryvm_vector_binary_fn sub[4];
+  ryvm_vector_binary_fn mul[4];
+  ryvm_vector_binary_fn cmpeq[4]; //lanes are set to all 1s if equal, and 0 otherwise
+  ryvm_vector_binary_fn cmpgt[4]; //signed comparison, lanes are set to all 1s if a > b, and 0 otherwise
+
+  ryvm_vector_binary_fn addf[2];
+  ryvm_vector_binary_fn subf[2];
+  ryvm_vector_binary_fn mulf[2];
+};
+
+//pick the fastest implementation that the CPU supports. Setting the RYVM_VECTOR environment variable
+//to "scalar", "sse2", or "avx2" forces a specific implementation, as long as the CPU supports it.
+const struct ryvm_vector_impl* ryvm_vector_select(void);
+
+//convert the bytewidth of a register to the index of the lane width in struct ryvm_vector_impl
+uint8_t ryvm_vector_lane_index(uint8_t bytewidth);
+uint8_t ryvm_vector_float_index(uint8_t bytewidth);
+
+//sum every lane of src. The sum wraps around on overflow for integers.
+uint64_t ryvm_vector_reduce_add(const uint8_t *src, uint8_t lane_bytewidth);
+
+//sum every lane of src as floats. Only the first lane_bytewidth bytes of the result are used.
+uint64_t ryvm_vector_reduce_addf(const uint8_t *src, uint8_t lane_bytewidth);
+
+//copy the first lane_bytewidth bytes of value to every lane of dest
+void ryvm_vector_dup(uint8_t *dest, uint64_t value, uint8_t lane_bytewidth);
+
+//build a bitmask from the most significant bit of each lane. Bit i of the result comes from lane i.
+uint64_t ryvm_vector_mask(const uint8_t *src, uint8_t lane_bytewidth);
+
+
+#endif // RYVM_VECTOR_H
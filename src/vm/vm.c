@@ -6,7 +6,11 @@
 
 
 #include "../helper.h"
+#include "../minifloat.h"
+#include "../compress.h"
+#include "../memory/pages.h"
 #include "vm.h"
+#include "atomic.h"
 
 
 /*
@@ -89,21 +93,223 @@ inline void ryvm_vm_flags_set_flag(struct ryvm *vm, uint8_t val, enum ryvm_vm_st
   }
 }
 
-int ryvm_vm_load(struct ryvm *vm, FILE *in) {
-  char magic[2];
-  fread(magic, 2, 1, in);
+void ryvm_vm_init(struct ryvm *vm) {
+  vm->gen_registers = vm->main_registers;
+  memset(vm->vec_registers, 0, sizeof(vm->vec_registers));
+  vm->vector = ryvm_vector_select();
+  vm->current_fiber = NULL;
+  vm->free_fibers = NULL;
+  for(uint8_t i = 0; i < RYVM_VM_MAX_THREADS; i++) {
+    vm->threads[i] = NULL;
+  }
+  vm->data_and_code = NULL;
+  vm->data_and_code_size = 0;
+  vm->owns_data_and_code = 0;
+  vm->text_section_start = 0;
+  vm->stack = NULL;
+  vm->stack_size = 0;
+  vm->page_flags = MEMORY_PAGE_FLAG_NONE;
+  vm->num_host_regions = 0;
+  vm->num_channels = 0;
+  vm->owned_channels = 0;
+  vm->num_mapped_files = 0;
+  ryvm_output_init(&vm->output);
+  vm->aio = NULL;
+  vm->profile = NULL;
+  ryvm_symbols_init(&vm->symbols);
+  vm->is_running = 0;
+}
+
+int ryvm_vm_add_host_region(struct ryvm *vm, void *data, uint64_t size, uint32_t access) {
+  if(vm->num_host_regions >= RYVM_VM_MAX_HOST_REGIONS) {
+    return -1;
+  }
+
+  struct ryvm_host_region *region = &vm->host_regions[vm->num_host_regions];
+  region->data = data;
+  region->size = size;
+  region->access = access;
+
+  return vm->num_host_regions++;
+}
+
+int ryvm_vm_add_channel(struct ryvm *vm, struct ryvm_channel *channel) {
+  if(vm->num_channels >= RYVM_VM_MAX_CHANNELS) {
+    return -1;
+  }
+
+  vm->channels[vm->num_channels] = channel;
+  return vm->num_channels++;
+}
+
+struct ryvm_channel* ryvm_vm_get_channel(struct ryvm *vm, uint64_t id) {
+  return id < vm->num_channels ? vm->channels[id] : NULL;
+}
+
+//SYS 22: send the value in W2 to the channel with the id in W1. If W3 is not 0, wait while the channel is full.
+//W0 is set to a ryvm_channel_status. Sending to a channel that does not exist acts like sending to a closed channel.
+void ryvm_vm_sys_channel_send(struct ryvm *vm) {
+  struct ryvm_channel *channel = ryvm_vm_get_channel(vm, vm->gen_registers[1]);
+  if(channel == NULL) {
+    vm->gen_registers[0] = RYVM_CHANNEL_STATUS_CLOSED;
+  } else if(vm->gen_registers[3] != 0) {
+    vm->gen_registers[0] = ryvm_channel_send_wait(channel, vm->gen_registers[2]);
+  } else {
+    vm->gen_registers[0] = ryvm_channel_send(channel, vm->gen_registers[2]);
+  }
+}
+
+//SYS 23: receive a value from the channel with the id in W1 and store it in W1. If W2 is not 0, wait while the channel is empty.
+//W0 is set to a ryvm_channel_status.
+void ryvm_vm_sys_channel_receive(struct ryvm *vm) {
+  struct ryvm_channel *channel = ryvm_vm_get_channel(vm, vm->gen_registers[1]);
+  uint64_t value = 0;
+  if(channel == NULL) {
+    vm->gen_registers[0] = RYVM_CHANNEL_STATUS_CLOSED;
+  } else if(vm->gen_registers[2] != 0) {
+    vm->gen_registers[0] = ryvm_channel_receive_wait(channel, &value);
+  } else {
+    vm->gen_registers[0] = ryvm_channel_receive(channel, &value);
+  }
+  vm->gen_registers[1] = value;
+}
+
+//SYS 25: create a channel that holds at least W1 messages. Its id is stored in W0, 
+//and W1 is set to 0 on success or 1 on failure.
+void ryvm_vm_sys_channel_create(struct ryvm *vm) {
+  struct ryvm_channel *channel = NULL;
+  if(vm->num_channels < RYVM_VM_MAX_CHANNELS) {
+    channel = ryvm_channel_create(vm->gen_registers[1]);
+  }
+  if(channel == NULL) {
+    vm->gen_registers[1] = 1;
+    return;
+  }
+
+  int id = ryvm_vm_add_channel(vm, channel);
+  vm->owned_channels |= (uint16_t) (1u << id);
+  vm->gen_registers[0] = (uint64_t) id;
+  vm->gen_registers[1] = 0;
+}
+
+//SYS 5: map the file whose null-terminated path is at W1 using the ryvm_mapped_file_mode in W2.
+//The address of the mapping is returned in W0 and its length in W1. W2 is set to 0 on success, or 1 on
+//failure, in which case W0 and W1 are 0. Empty files have nothing to unmap, so they do not use up a mapping.
+void ryvm_vm_sys_map_file(struct ryvm *vm) {
+  struct ryvm_mapped_file file;
+  vm->gen_registers[0] = 0;
+
+  if(vm->num_mapped_files >= RYVM_VM_MAX_MAPPED_FILES
+  || !ryvm_mapped_file_open(&file, (const char*) vm->gen_registers[1], (uint32_t) vm->gen_registers[2])) {
+    vm->gen_registers[1] = 0;
+    vm->gen_registers[2] = 1;
+    return;
+  }
 
-  if(magic[0] != 'R' || magic[1] != 'Y') {
+  if(file.data == NULL) {
+    ryvm_mapped_file_close(&file);
+  } else {
+    vm->mapped_files[vm->num_mapped_files++] = file;
+  }
+  vm->gen_registers[0] = (uint64_t) file.data;
+  vm->gen_registers[1] = file.size;
+  vm->gen_registers[2] = 0;
+}
+
+//SYS 6: unmap the file mapped at the address in W1. W0 is set to 0 on success,
+//or 1 if no file is mapped at that address.
+void ryvm_vm_sys_unmap_file(struct ryvm *vm) {
+  uint8_t *address = (uint8_t*) vm->gen_registers[1];
+
+  for(uint8_t i = 0; i < vm->num_mapped_files; i++) {
+    if(vm->mapped_files[i].data == address) {
+      ryvm_mapped_file_close(&vm->mapped_files[i]);
+
+      //order does not matter, so fill the gap with the last mapping
+      vm->mapped_files[i] = vm->mapped_files[--vm->num_mapped_files];
+      vm->gen_registers[0] = 0;
+      return;
+    }
+  }
+
+  vm->gen_registers[0] = 1;
+}
+
+//SYS 13: service the async I/O ring at W1 with W2 entries using W3 worker threads (0 for the default).
+//W0 is set to 0 on success and 1 on failure. Any ring set up before is shut down first.
+void ryvm_vm_sys_aio_setup(struct ryvm *vm) {
+  ryvm_aio_free(vm->aio);
+  vm->aio = ryvm_aio_create((uint8_t*) vm->gen_registers[1], vm->gen_registers[2], (uint32_t) vm->gen_registers[3]);
+  vm->gen_registers[0] = vm->aio == NULL;
+}
+
+//SYS 16: create a fiber starting at the address in W1, with a stack of W2 bytes (0 for the default)
+//and its argument in W3. The id of the fiber is stored in W0, and W1 is set to 0 on success or 1 on failure.
+void ryvm_vm_sys_fiber_create(struct ryvm *vm) {
+  uint64_t id;
+  if(ryvm_fiber_create(vm, vm->gen_registers[1], vm->gen_registers[2], vm->gen_registers[3], &id)) {
+    vm->gen_registers[0] = id;
+    vm->gen_registers[1] = 0;
+  } else {
+    vm->gen_registers[1] = 1;
+  }
+}
+
+//SYS 20: spawn a host thread starting at the address in W1, with a stack of W2 bytes (0 for the default)
+//and its argument in W3. The id of the thread is stored in W0, and W1 is set to 0 on success or 1 on failure.
+void ryvm_vm_sys_thread_spawn(struct ryvm *vm) {
+  uint64_t id;
+  if(ryvm_thread_spawn(vm, vm->gen_registers[1], vm->gen_registers[2], vm->gen_registers[3], &id)) {
+    vm->gen_registers[0] = id;
+    vm->gen_registers[1] = 0;
+  } else {
+    vm->gen_registers[1] = 1;
+  }
+}
+
+//SYS 21: wait for the thread with the id in W1 to finish. Its result is stored in W0, 
+//and W1 is set to 0 on success or 1 if there is no thread with that id.
+void ryvm_vm_sys_thread_join(struct ryvm *vm) {
+  uint64_t result;
+  if(ryvm_thread_join(vm, vm->gen_registers[1], &result)) {
+    vm->gen_registers[0] = result;
+    vm->gen_registers[1] = 0;
+  } else {
+    vm->gen_registers[1] = 1;
+  }
+}
+
+//allocate memory for the data/text block or the stack, using huge pages if the VM was configured to.
+uint8_t* ryvm_vm_alloc_region(struct ryvm *vm, uint64_t size) {
+  if(vm->page_flags != MEMORY_PAGE_FLAG_NONE) {
+    return memory_pages_alloc(size, vm->page_flags);
+  }
+  return malloc(size);
+}
+
+void ryvm_vm_free_region(struct ryvm *vm, uint8_t *region, uint64_t size) {
+  if(vm->page_flags != MEMORY_PAGE_FLAG_NONE) {
+    memory_pages_free(region, size, vm->page_flags);
+  } else {
+    free(region);
+  }
+}
+
+//read the header at the start of a .ryc image and allocate the stack.
+int ryvm_vm_load_header(struct ryvm *vm, const uint8_t *header, uint64_t *data_size, uint64_t *text_size) {
+  if(header[0] != 'R' || header[1] != 'Y') {
     printf("Invalid file! Not a RyVM bytecode file!\n");
     return 0;
   }
 
-  //read max_stack_size
-  fread(&vm->stack_size, 8, 1, in);
+  //the byte after the magic number holds the image flags, which the callers check. The other 5 bytes are reserved
+  memcpy(&vm->stack_size, header + 8, 8);
+  memcpy(data_size, header + 16, 8);
+  memcpy(text_size, header + 24, 8);
 
   if(vm->stack_size != 0) {
-  //fine to use malloc since size of memory will never grow or shrink
-    vm->stack = malloc(vm->stack_size);
+  //fine to allocate once since size of memory will never grow or shrink
+    vm->stack = ryvm_vm_alloc_region(vm, vm->stack_size);
     if(vm->stack == NULL) {
       printf("Cannot allocate enough memory for stack!");
       return 0;
@@ -112,49 +318,149 @@ int ryvm_vm_load(struct ryvm *vm, FILE *in) {
     vm->stack = NULL;
   }
 
-  
+  vm->text_section_start = *data_size;
+  vm->data_and_code_size = *data_size + *text_size;
 
-  //read size of data section
-  uint64_t data_size;
-  fread(&data_size, 8, 1, in);
+  return 1;
+}
 
-  
+//change the relative address stored at a hole to a true in-memory address.
+//Returns 0 if the hole or the value is outside of the data and text sections.
+int ryvm_vm_relocate(struct ryvm *vm, uint64_t reloc_relative_address_hole, uint64_t reloc_relative_address_value) {
+  if(vm->data_and_code_size < 8 || reloc_relative_address_hole > vm->data_and_code_size - 8 
+    || reloc_relative_address_value > vm->data_and_code_size) {
+    printf("Invalid image! Relocation entry points outside of the data and text sections!\n");
+    return 0;
+  }
 
-  vm->text_section_start = data_size;
+  uint64_t true_address_of_value = (uint64_t) (vm->data_and_code + reloc_relative_address_value);
 
-  //load data into data_and_code memory block if there is data
-  if(data_size != 0) {
-    vm->data_and_code = malloc(data_size);
-    if(vm->data_and_code == NULL) {
-      printf("Cannot allocate enough memory for data!");
+  //holes are not guaranteed to be aligned
+  memcpy(vm->data_and_code + reloc_relative_address_hole, &true_address_of_value, 8);
+  return 1;
+}
+
+//read the symbol table that follows the relocation table, if the image has one
+int ryvm_vm_load_symbols(struct ryvm *vm, uint8_t flags, const uint8_t *bytes, size_t size) {
+  if(!(flags & RYVM_IMAGE_FLAG_SYMBOLS)) {
+    return 1;
+  }
+  if(ryvm_symbols_read(&vm->symbols, bytes, size) == 0) {
+    printf("Invalid image! Cannot read symbol table!\n");
+    return 0;
+  }
+  return 1;
+}
+
+//load the sections that follow the header of an image whose text section is compressed.
+//The text section is expanded into a newly allocated data/text block, so body can be freed afterwards.
+int ryvm_vm_load_compressed(struct ryvm *vm, uint8_t flags, const uint8_t *body, size_t body_size, uint64_t data_size, uint64_t text_size) {
+  if(data_size > body_size) {
+    printf("Invalid image! Sections do not fit in image!\n");
+    return 0;
+  }
+
+  vm->data_and_code = ryvm_vm_alloc_region(vm, vm->data_and_code_size);
+  if(vm->data_and_code == NULL) {
+    printf("Cannot allocate enough memory for data!");
+    return 0;
+  }
+  vm->owns_data_and_code = 1;
+
+  memcpy(vm->data_and_code, body, data_size);
+
+  size_t text_stored_size = ryvm_compress_expand(body + data_size, body_size - data_size, vm->data_and_code + data_size, text_size);
+  if(text_stored_size == 0 && text_size != 0) {
+    printf("Invalid image! Cannot expand compressed text section!\n");
+    return 0;
+  }
+
+  size_t reloc_table_offset = data_size + text_stored_size;
+  uint64_t num_reloc_entries;
+  if(reloc_table_offset + 8 > body_size) {
+    printf("Invalid image! Relocation table does not fit in image!\n");
+    return 0;
+  }
+  memcpy(&num_reloc_entries, body + reloc_table_offset, 8);
+  if(num_reloc_entries > (body_size - reloc_table_offset - 8) / 16) {
+    printf("Invalid image! Relocation table does not fit in image!\n");
+    return 0;
+  }
+
+  const uint8_t *reloc_entry = body + reloc_table_offset + 8;
+  for(uint64_t i = 0; i < num_reloc_entries; i++) {
+    uint64_t reloc_relative_address_hole;
+    uint64_t reloc_relative_address_value;
+
+    memcpy(&reloc_relative_address_hole, reloc_entry, 8);
+    memcpy(&reloc_relative_address_value, reloc_entry + 8, 8);
+    reloc_entry += 16;
+
+    if(!ryvm_vm_relocate(vm, reloc_relative_address_hole, reloc_relative_address_value)) {
       return 0;
     }
-    //put data at beginning
-    fread(vm->data_and_code, data_size, 1, in);
-  } 
+  }
 
-  uint64_t text_size;
-  fread(&text_size, 8, 1, in);
+  return ryvm_vm_load_symbols(vm, flags, reloc_entry, body + body_size - reloc_entry);
+}
 
-  if(data_size != 0) {
-    uint8_t *tmp = realloc(vm->data_and_code, data_size + text_size);
-    if(tmp == NULL) {
-      free(vm->data_and_code);
-      printf("Cannot allocate enough memory for data!");
-      return 0;
+//read everything left in the file into a malloc'ed buffer
+uint8_t* ryvm_vm_read_rest(FILE *in, size_t *size) {
+  size_t capacity = 4096;
+  uint8_t *buffer = malloc(capacity);
+  *size = 0;
+  while(buffer != NULL) {
+    *size += fread(buffer + *size, 1, capacity - *size, in);
+    if(*size < capacity) {
+      return buffer;
     }
 
-    vm->data_and_code = tmp;
-  } else {
-    vm->data_and_code = malloc(text_size);
-    if(vm->data_and_code == NULL) {
+    capacity *= 2;
+    uint8_t *bigger = realloc(buffer, capacity);
+    if(bigger == NULL) {
+      free(buffer);
+    }
+    buffer = bigger;
+  }
+  return NULL;
+}
+
+static int ryvm_vm_load_file(struct ryvm *vm, FILE *in) {
+  uint8_t header[RYVM_IMAGE_HEADER_SIZE];
+  if(fread(header, RYVM_IMAGE_HEADER_SIZE, 1, in) != 1) {
+    printf("Invalid file! Not a RyVM bytecode file!\n");
+    return 0;
+  }
+
+  uint64_t data_size;
+  uint64_t text_size;
+  if(!ryvm_vm_load_header(vm, header, &data_size, &text_size)) {
+    return 0;
+  }
+
+  //the compressed text section has no fixed size, so the rest of the file is read at once
+  if(header[RYVM_IMAGE_FLAGS_OFFSET] & RYVM_IMAGE_FLAG_COMPRESSED) {
+    size_t body_size;
+    uint8_t *body = ryvm_vm_read_rest(in, &body_size);
+    if(body == NULL) {
       printf("Cannot allocate enough memory for data!");
       return 0;
     }
+    int success = ryvm_vm_load_compressed(vm, header[RYVM_IMAGE_FLAGS_OFFSET], body, body_size, data_size, text_size);
+    free(body);
+    return success;
   }
 
-  //read text section into memory
-  fread(vm->data_and_code + data_size, text_size, 1, in);
+  //the data and text sections are stored next to each other, so they can be read in one go.
+  //This way, the block never needs to be moved, which is required when it is backed by huge pages.
+  vm->data_and_code = ryvm_vm_alloc_region(vm, vm->data_and_code_size);
+  if(vm->data_and_code == NULL) {
+    printf("Cannot allocate enough memory for data!");
+    return 0;
+  }
+  vm->owns_data_and_code = 1;
+
+  fread(vm->data_and_code, vm->data_and_code_size, 1, in);
 
   uint64_t num_reloc_entries;
   fread(&num_reloc_entries, 8, 1, in);
@@ -167,19 +473,104 @@ int ryvm_vm_load(struct ryvm *vm, FILE *in) {
     uint64_t reloc_relative_address_hole;
     uint64_t reloc_relative_address_value;
 
-    fread(&reloc_relative_address_hole, 8, 1, in);
-    fread(&reloc_relative_address_value, 8, 1, in);
+    if(fread(&reloc_relative_address_hole, 8, 1, in) != 1 || fread(&reloc_relative_address_value, 8, 1, in) != 1) {
+      printf("Invalid image! Relocation table does not fit in image!\n");
+      return 0;
+    }
+
+    if(!ryvm_vm_relocate(vm, reloc_relative_address_hole, reloc_relative_address_value)) {
+      return 0;
+    }
+  }
+
+  if(header[RYVM_IMAGE_FLAGS_OFFSET] & RYVM_IMAGE_FLAG_SYMBOLS) {
+    size_t symbols_size;
+    uint8_t *symbols = ryvm_vm_read_rest(in, &symbols_size);
+    if(symbols == NULL) {
+      printf("Cannot allocate enough memory for symbol table!");
+      return 0;
+    }
+    int success = ryvm_vm_load_symbols(vm, header[RYVM_IMAGE_FLAGS_OFFSET], symbols, symbols_size);
+    free(symbols);
+    return success;
+  }
+
+  return 1;
+}
+
+static int ryvm_vm_load_from_image(struct ryvm *vm, uint8_t *image, size_t image_size) {
+  uint64_t data_size;
+  uint64_t text_size;
+  if(image_size < RYVM_IMAGE_HEADER_SIZE + 8) {
+    printf("Invalid image! Not a RyVM bytecode image!\n");
+    return 0;
+  }
+  if(!ryvm_vm_load_header(vm, image, &data_size, &text_size)) {
+    return 0;
+  }
+
+  if(image[RYVM_IMAGE_FLAGS_OFFSET] & RYVM_IMAGE_FLAG_COMPRESSED) {
+    return ryvm_vm_load_compressed(vm, image[RYVM_IMAGE_FLAGS_OFFSET], image + RYVM_IMAGE_HEADER_SIZE, image_size - RYVM_IMAGE_HEADER_SIZE, data_size, text_size);
+  }
+
+  uint64_t reloc_table_offset = RYVM_IMAGE_HEADER_SIZE + vm->data_and_code_size;
+  uint64_t num_reloc_entries;
+  if(data_size > image_size || text_size > image_size || reloc_table_offset + 8 > image_size) {
+    printf("Invalid image! Sections do not fit in image!\n");
+    return 0;
+  }
+  memcpy(&num_reloc_entries, image + reloc_table_offset, 8);
+  if(num_reloc_entries > (image_size - reloc_table_offset - 8) / 16) {
+    printf("Invalid image! Relocation table does not fit in image!\n");
+    return 0;
+  }
+
+  //run the program directly from the image instead of copying it.
+  vm->data_and_code = image + RYVM_IMAGE_HEADER_SIZE;
+  vm->owns_data_and_code = 0;
+
+  const uint8_t *reloc_entry = image + reloc_table_offset + 8;
+  for(uint64_t i = 0; i < num_reloc_entries; i++) {
+    uint64_t reloc_relative_address_hole;
+    uint64_t reloc_relative_address_value;
 
-    uint64_t true_address_of_value = (uint64_t) (vm->data_and_code + reloc_relative_address_value);
+    memcpy(&reloc_relative_address_hole, reloc_entry, 8);
+    memcpy(&reloc_relative_address_value, reloc_entry + 8, 8);
+    reloc_entry += 16;
 
-    uint64_t *hole = (uint64_t*) (vm->data_and_code + reloc_relative_address_hole);
-    *hole = true_address_of_value; 
+    if(!ryvm_vm_relocate(vm, reloc_relative_address_hole, reloc_relative_address_value)) {
+      return 0;
+    }
   }
 
+  return ryvm_vm_load_symbols(vm, image[RYVM_IMAGE_FLAGS_OFFSET], reloc_entry, image + image_size - reloc_entry);
+}
 
-  //
+//free everything a failed load allocated, so the caller does not have to call ryvm_vm_free
+void ryvm_vm_load_failed(struct ryvm *vm) {
+  ryvm_symbols_free(&vm->symbols);
+  ryvm_vm_free_region(vm, vm->stack, vm->stack_size);
+  if(vm->owns_data_and_code) {
+    ryvm_vm_free_region(vm, vm->data_and_code, vm->data_and_code_size);
+  }
+  vm->stack = NULL;
+  vm->data_and_code = NULL;
+  vm->owns_data_and_code = 0;
+}
 
+int ryvm_vm_load(struct ryvm *vm, FILE *in) {
+  if(!ryvm_vm_load_file(vm, in)) {
+    ryvm_vm_load_failed(vm);
+    return 0;
+  }
+  return 1;
+}
 
+int ryvm_vm_load_image(struct ryvm *vm, uint8_t *image, size_t image_size) {
+  if(!ryvm_vm_load_from_image(vm, image, image_size)) {
+    ryvm_vm_load_failed(vm);
+    return 0;
+  }
   return 1;
 }
 
@@ -232,7 +623,65 @@ void ryvm_vm_signed_int_arith(struct ryvm *vm, uint8_t reg1_num, uint8_t reg1_by
   memcpy(&vm->gen_registers[reg1_num], &value, reg1_bytewidth); 
 }
 
+//multiply the sign or zero extended values of W1 and W2, and keep the bits of the product
+//right above the bytewidth of W0. For 64-bit registers, this is the upper 64 bits of the 128-bit product.
+void ryvm_vm_mul_high(struct ryvm *vm, uint8_t reg1_num, uint8_t reg1_bytewidth, uint8_t reg2_num, uint8_t reg2_bytewidth, uint8_t reg3_num, uint8_t reg3_bytewidth, uint8_t is_signed) {
+  uint64_t a = 0;
+  uint64_t b = 0;
+  if(is_signed) {
+    a = (uint64_t) ryvm_vm_helper_sign_extend_64((uint8_t*) &vm->gen_registers[reg2_num], reg2_bytewidth);
+    b = (uint64_t) ryvm_vm_helper_sign_extend_64((uint8_t*) &vm->gen_registers[reg3_num], reg3_bytewidth);
+  } else {
+    memcpy(&a, &vm->gen_registers[reg2_num], reg2_bytewidth);
+    memcpy(&b, &vm->gen_registers[reg3_num], reg3_bytewidth);
+  }
+
+  uint64_t low;
+  uint64_t high;
+  ryvm_vm_helper_mul_128(a, b, is_signed, &low, &high);
+
+  uint8_t bits = reg1_bytewidth * 8;
+  uint64_t value = bits == 64 ? high : (low >> bits) | (high << (64 - bits));
+  memcpy(&vm->gen_registers[reg1_num], &value, reg1_bytewidth);
+}
+
+//store a float in a register using the format that matches its bytewidth
+void ryvm_vm_store_float(struct ryvm *vm, uint8_t reg_num, uint8_t reg_bytewidth, double value) {
+  uint64_t bits;
+  if(reg_bytewidth > 4) {
+    memcpy(&bits, &value, 8);
+  } else {
+    bits = ryvm_vm_helper_float_to_reg((float) value, reg_bytewidth);
+  }
+  memcpy(&vm->gen_registers[reg_num], &bits, reg_bytewidth);
+}
+
+//perform an arithmetic operation on registers that all hold the same float type, so no conversions are needed
+#define RYVM_VM_FLOAT_ARITH_SAME_WIDTH(type, rem) { \
+    type a; \
+    type b; \
+    type value; \
+    memcpy(&a, &vm->gen_registers[reg2_num], sizeof(type)); \
+    memcpy(&b, &vm->gen_registers[reg3_num], sizeof(type)); \
+    switch(op) { \
+      case RYVM_VM_ARITH_OP_ADD: value = a + b; break; \
+      case RYVM_VM_ARITH_OP_SUB: value = a - b; break; \
+      case RYVM_VM_ARITH_OP_MUL: value = a * b; break; \
+      case RYVM_VM_ARITH_OP_DIV: value = a / b; break; \
+      case RYVM_VM_ARITH_OP_REM: value = rem(a, b); break; \
+      default: assert(0); \
+    } \
+    memcpy(&vm->gen_registers[reg1_num], &value, sizeof(type)); \
+    return; \
+  }
+
 void ryvm_vm_float_arith(struct ryvm *vm, uint8_t reg1_num, uint8_t reg1_bytewidth, uint8_t reg2_num, uint8_t reg2_bytewidth, uint8_t reg3_num, uint8_t reg3_bytewidth, enum ryvm_vm_arith_op op) {
+  //most programs never mix float widths, so handle that case without any conversions
+  if(reg1_bytewidth == reg2_bytewidth && reg2_bytewidth == reg3_bytewidth) {
+    if(reg1_bytewidth == 8) RYVM_VM_FLOAT_ARITH_SAME_WIDTH(double, fmod)
+    if(reg1_bytewidth == 4) RYVM_VM_FLOAT_ARITH_SAME_WIDTH(float, fmodf)
+  }
+
   uint8_t largest_bytewidth = reg2_bytewidth > reg3_bytewidth ? reg2_bytewidth : reg3_bytewidth;
 
   uint64_t result;
@@ -254,7 +703,7 @@ void ryvm_vm_float_arith(struct ryvm *vm, uint8_t reg1_num, uint8_t reg1_bytewid
 
     memcpy(&result, &value, 8);
   } 
-  //TODO: Implement 16-bit IEEE 754 floating point and find a 8-bit floating point.
+  //32-bit floats, along with f16 and FP8, which are computed as 32-bit floats
   else {
     float a = ryvm_vm_helper_reg_to_float(vm->gen_registers[reg2_num], reg2_bytewidth);
     float b = ryvm_vm_helper_reg_to_float(vm->gen_registers[reg3_num], reg3_bytewidth);
@@ -265,7 +714,7 @@ void ryvm_vm_float_arith(struct ryvm *vm, uint8_t reg1_num, uint8_t reg1_bytewid
       case RYVM_VM_ARITH_OP_SUB: value = a - b; break;
       case RYVM_VM_ARITH_OP_MUL: value = a * b; break;
       case RYVM_VM_ARITH_OP_DIV: value = a / b; break;
-      case RYVM_VM_ARITH_OP_REM: value = fmod(a, b); break;
+      case RYVM_VM_ARITH_OP_REM: value = fmodf(a, b); break;
       default: assert(0);
     }
 
@@ -275,14 +724,225 @@ void ryvm_vm_float_arith(struct ryvm *vm, uint8_t reg1_num, uint8_t reg1_bytewid
   //note that depending on the bytewidth of the result register, we may need to 
   //cast the original result from a float to a double or vise versa.
 
+  //result holds a double or a 32-bit float, even when the sources were smaller floats
+  uint8_t result_bytewidth = largest_bytewidth > 4 ? 8 : 4;
+  ryvm_vm_store_float(vm, reg1_num, reg1_bytewidth, ryvm_vm_helper_reg_to_double(result, result_bytewidth));
+  
+}
+
+//read a register as a double or float, converting it if its bytewidth does not match
+#define RYVM_VM_FLOAT_OPERAND(type, num, bytewidth) \
+  (sizeof(type) == 8 ? (type) ryvm_vm_helper_reg_to_double(vm->gen_registers[num], bytewidth) : (type) ryvm_vm_helper_reg_to_float(vm->gen_registers[num], bytewidth))
+
+//the float instructions added after the basic arithmetic ones. They operate at the bytewidth of W0, 
+//where W registers hold doubles and every other register holds a float.
+#define RYVM_VM_FLOAT_MATH(type, suffix) { \
+    type a = RYVM_VM_FLOAT_OPERAND(type, reg2_num, reg2_bytewidth); \
+    type value; \
+    switch(op) { \
+      case RYVM_OP_FMA: { \
+        type acc = RYVM_VM_FLOAT_OPERAND(type, reg1_num, reg1_bytewidth); \
+        value = fma##suffix(a, RYVM_VM_FLOAT_OPERAND(type, reg3_num, reg3_bytewidth), acc); \
+        break; \
+      } \
+      case RYVM_OP_FMIN: value = fmin##suffix(a, RYVM_VM_FLOAT_OPERAND(type, reg3_num, reg3_bytewidth)); break; \
+      case RYVM_OP_FMAX: value = fmax##suffix(a, RYVM_VM_FLOAT_OPERAND(type, reg3_num, reg3_bytewidth)); break; \
+      case RYVM_OP_FSQRT: value = sqrt##suffix(a); break; \
+      case RYVM_OP_FABS: value = fabs##suffix(a); break; \
+      case RYVM_OP_FNEG: value = -a; break; \
+      case RYVM_OP_FRND: \
+        switch(imm & 3) { \
+          case 0: value = round##suffix(a); break; \
+          case 1: value = floor##suffix(a); break; \
+          case 2: value = ceil##suffix(a); break; \
+          default: value = trunc##suffix(a); break; \
+        } \
+        break; \
+      default: assert(0); \
+    } \
+    ryvm_vm_store_float(vm, reg1_num, reg1_bytewidth, value); \
+  }
+
+void ryvm_vm_float_math(struct ryvm *vm, enum ryvm_opcode op, uint8_t reg1_num, uint8_t reg1_bytewidth, uint8_t reg2_num, uint8_t reg2_bytewidth, uint8_t reg3_num, uint8_t reg3_bytewidth, uint8_t imm) {
+  if(reg1_bytewidth == 8) RYVM_VM_FLOAT_MATH(double, )
+  else RYVM_VM_FLOAT_MATH(float, f)
+}
+
+//the immediate of FXFP and FPFX
+#define RYVM_VM_FIXED_SIGNED 128
+#define RYVM_VM_FIXED_FRAC_BITS 127
+
+//the immediate of FXMUL and FXDIV. There are fewer fraction bits, since more than 63 makes no sense for a 64-bit register.
+#define RYVM_VM_FIXED_ROUND 64
+#define RYVM_VM_FIXED_MULDIV_FRAC_BITS 63
+
+void ryvm_vm_fixed_to_float(struct ryvm *vm, uint8_t reg1_num, uint8_t reg1_bytewidth, uint8_t reg2_num, uint8_t reg2_bytewidth, uint8_t imm) {
+  uint8_t frac_bits = imm & RYVM_VM_FIXED_FRAC_BITS;
+  uint64_t raw = 0;
+  memcpy(&raw, &vm->gen_registers[reg2_num], reg2_bytewidth);
+
+  //multiplying by a power of 2 is exact, so the only rounding happens when converting the integer
   if(reg1_bytewidth > 4) {
-    double res = ryvm_vm_helper_reg_to_double(result, largest_bytewidth);
-    memcpy(vm->gen_registers+reg1_num, &res, 8);
+    double scale = ryvm_vm_helper_pow2(-frac_bits);
+    double value = imm & RYVM_VM_FIXED_SIGNED
+      ? (double) ryvm_vm_helper_sign_extend_64((uint8_t*) &raw, reg2_bytewidth) * scale
+      : (double) raw * scale;
+    memcpy(&vm->gen_registers[reg1_num], &value, 8);
   } else {
-    float res = ryvm_vm_helper_reg_to_float(result, largest_bytewidth);
-    memcpy(vm->gen_registers+reg1_num, &res, 4);
+    float scale = (float) ryvm_vm_helper_pow2(-frac_bits);
+    float value = imm & RYVM_VM_FIXED_SIGNED
+      ? (float) ryvm_vm_helper_sign_extend_64((uint8_t*) &raw, reg2_bytewidth) * scale
+      : (float) raw * scale;
+    ryvm_vm_store_float(vm, reg1_num, reg1_bytewidth, value);
   }
-  
+}
+
+void ryvm_vm_float_to_fixed(struct ryvm *vm, uint8_t reg1_num, uint8_t reg1_bytewidth, uint8_t reg2_num, uint8_t reg2_bytewidth, uint8_t imm) {
+  uint8_t bits = reg1_bytewidth * 8;
+
+  //floats convert to doubles exactly, so both are handled as doubles
+  double value = round(ryvm_vm_helper_reg_to_double(vm->gen_registers[reg2_num], reg2_bytewidth) * ryvm_vm_helper_pow2(imm & RYVM_VM_FIXED_FRAC_BITS));
+
+  uint64_t result;
+  if(imm & RYVM_VM_FIXED_SIGNED) {
+    double limit = ryvm_vm_helper_pow2(bits - 1);
+    if(value != value) {
+      result = 0; //NaN
+    } else if(value >= limit) {
+      result = UINT64_MAX >> (65 - bits); //largest positive number
+    } else if(value < -limit) {
+      result = ~(UINT64_MAX >> (65 - bits)); //smallest negative number
+    } else {
+      result = (uint64_t) (int64_t) value;
+    }
+  } else {
+    double limit = ryvm_vm_helper_pow2(bits);
+    if(!(value > 0)) {
+      result = 0; //negative or NaN
+    } else if(value >= limit) {
+      result = UINT64_MAX;
+    } else {
+      result = (uint64_t) value;
+    }
+  }
+
+  memcpy(&vm->gen_registers[reg1_num], &result, reg1_bytewidth);
+}
+
+//W0 = (W0 * W1) >> frac_bits for FXMUL, or W0 = (W0 << frac_bits) / W1 for FXDIV.
+//The math is done on the magnitudes of both numbers with 128 bits of precision, and the sign is applied
+//at the end, so rounding is symmetric around 0. Results that do not fit in W0 are saturated.
+void ryvm_vm_fixed_mul_div(struct ryvm *vm, uint8_t reg1_num, uint8_t reg1_bytewidth, uint8_t reg2_num, uint8_t reg2_bytewidth, uint8_t imm, uint8_t is_div) {
+  uint8_t is_signed = (imm & RYVM_VM_FIXED_SIGNED) != 0;
+  uint8_t frac_bits = imm & RYVM_VM_FIXED_MULDIV_FRAC_BITS;
+  uint8_t bits = reg1_bytewidth * 8;
+
+  uint64_t a = 0;
+  uint64_t b = 0;
+  uint8_t negative = 0;
+  if(is_signed) {
+    int64_t sa = ryvm_vm_helper_sign_extend_64((uint8_t*) &vm->gen_registers[reg1_num], reg1_bytewidth);
+    int64_t sb = ryvm_vm_helper_sign_extend_64((uint8_t*) &vm->gen_registers[reg2_num], reg2_bytewidth);
+    negative = (sa < 0) != (sb < 0);
+    //negate as unsigned so that INT64_MIN does not overflow
+    a = sa < 0 ? 0 - (uint64_t) sa : (uint64_t) sa;
+    b = sb < 0 ? 0 - (uint64_t) sb : (uint64_t) sb;
+  } else {
+    memcpy(&a, &vm->gen_registers[reg1_num], reg1_bytewidth);
+    memcpy(&b, &vm->gen_registers[reg2_num], reg2_bytewidth);
+  }
+
+  uint64_t high;
+  uint64_t low;
+  uint8_t overflow = 0;
+
+  if(!is_div) {
+    ryvm_vm_helper_mul_128(a, b, 0, &low, &high);
+    if(frac_bits > 0) {
+      if(imm & RYVM_VM_FIXED_ROUND) {
+        uint64_t half = 1ULL << (frac_bits - 1);
+        low += half;
+        high += low < half; //carry
+      }
+      low = (low >> frac_bits) | (high << (64 - frac_bits));
+      high >>= frac_bits;
+    }
+  } else if(b == 0) {
+    //dividing by 0 saturates, unless the dividend is 0 too
+    overflow = a != 0;
+    high = 0;
+    low = 0;
+  } else {
+    uint64_t remainder;
+    uint64_t shifted_high = frac_bits > 0 ? a >> (64 - frac_bits) : 0;
+    ryvm_vm_helper_udiv_128(shifted_high, a << frac_bits, b, &high, &low, &remainder);
+    //round half away from 0, written to avoid overflowing remainder * 2
+    if((imm & RYVM_VM_FIXED_ROUND) && remainder >= b - remainder) {
+      low++;
+      high += low == 0;
+    }
+  }
+
+  //the largest magnitude that fits in W0. Negative numbers can go 1 further.
+  uint64_t max = is_signed ? (UINT64_MAX >> (65 - bits)) + negative : UINT64_MAX >> (64 - bits);
+  if(overflow || high != 0 || low > max) {
+    low = max;
+  }
+
+  uint64_t result = negative ? 0 - low : low;
+  memcpy(&vm->gen_registers[reg1_num], &result, reg1_bytewidth);
+}
+
+//returns 1 if the fused compare-and-branch op should jump. Each register is
+//extended from its own bytewidth, so W0 and a smaller H1 can be compared directly.
+uint8_t ryvm_vm_compare_branch_taken(struct ryvm *vm, enum ryvm_opcode op, uint8_t reg1_num, uint8_t reg1_bytewidth, uint8_t reg2_num, uint8_t reg2_bytewidth) {
+  uint64_t a = 0;
+  uint64_t b = 0;
+  memcpy(&a, &vm->gen_registers[reg1_num], reg1_bytewidth);
+  memcpy(&b, &vm->gen_registers[reg2_num], reg2_bytewidth);
+
+  switch(op) {
+    case RYVM_OP_CBEQ: return a == b;
+    case RYVM_OP_CBNE: return a != b;
+    case RYVM_OP_CBLTU: return a < b;
+    case RYVM_OP_CBGEU: return a >= b;
+    default: break;
+  }
+
+  int64_t sa = ryvm_vm_helper_sign_extend_64((uint8_t*) &vm->gen_registers[reg1_num], reg1_bytewidth);
+  int64_t sb = ryvm_vm_helper_sign_extend_64((uint8_t*) &vm->gen_registers[reg2_num], reg2_bytewidth);
+  return op == RYVM_OP_CBLT ? sa < sb : sa >= sb;
+}
+
+//returns 1 if the SF register satisfies the condition code. Unknown codes never hold.
+uint8_t ryvm_vm_condition_holds(struct ryvm *vm, uint8_t condition) {
+  uint64_t sf = ryvm_vm_flags(vm);
+  uint8_t z = (sf & RYVM_VM_STATUS_FLAG_Z) != 0;
+  uint8_t lt = ((sf & RYVM_VM_STATUS_FLAG_N) != 0) != ((sf & RYVM_VM_STATUS_FLAG_V) != 0);
+
+  switch(condition) {
+    case RYVM_VM_CONDITION_EQ: return z;
+    case RYVM_VM_CONDITION_NE: return !z;
+    case RYVM_VM_CONDITION_LT: return lt;
+    case RYVM_VM_CONDITION_GT: return (lt | z) ^ 1;
+    case RYVM_VM_CONDITION_LE: return lt | z;
+    case RYVM_VM_CONDITION_GE: return (lt ^ 1) | z;
+    default: return 0;
+  }
+}
+
+//W0 = cond ? W1 : W0 (+ 1 for CSINC). The choice is made with a mask instead of a branch,
+//so data dependent conditions don't cause mispredictions inside the interpreter.
+void ryvm_vm_conditional_select(struct ryvm *vm, uint8_t reg1_num, uint8_t reg1_bytewidth, uint8_t reg2_num, uint8_t reg2_bytewidth, uint8_t condition, uint8_t increment) {
+  uint64_t a = 0;
+  uint64_t b = 0;
+  memcpy(&a, &vm->gen_registers[reg2_num], reg2_bytewidth);
+  memcpy(&b, &vm->gen_registers[reg1_num], reg1_bytewidth);
+  b += increment;
+
+  uint64_t mask = 0 - (uint64_t) ryvm_vm_condition_holds(vm, condition);
+  uint64_t result = (a & mask) | (b & ~mask);
+  memcpy(&vm->gen_registers[reg1_num], &result, reg1_bytewidth);
 }
 
 int64_t ryvm_vm_run(struct ryvm *vm) {
@@ -292,18 +952,41 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
   ryvm_vm_stack_ptr_set(vm, (uint64_t) vm->stack);
   ryvm_vm_frame_ptr_set(vm, (uint64_t) vm->stack);
 
-  vm->is_running = 1;
+  //pass the address and size of each host region in a pair of registers.
+  //unused pairs are zeroed so the guest can tell how many regions it was given.
+  for(uint8_t i = 0; i < RYVM_VM_MAX_HOST_REGIONS; i++) {
+    uint8_t used = i < vm->num_host_regions;
+    vm->gen_registers[2*i] = used ? (uint64_t) vm->host_regions[i].data : 0;
+    vm->gen_registers[2*i + 1] = used ? vm->host_regions[i].size : 0;
+  }
 
+  return ryvm_vm_execute(vm);
+}
 
-  int64_t result = -1;
+#if defined(__GNUC__) || defined(__clang__)
+  #define RYVM_VM_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+  #define RYVM_VM_ALWAYS_INLINE inline
+#endif
 
-  
+//the dispatch loop. ryvm_vm_execute inlines a copy for profiling and a copy where profile is NULL,
+//so the copy used normally has no profiling code in it at all.
+static RYVM_VM_ALWAYS_INLINE int64_t ryvm_vm_dispatch(struct ryvm *vm, struct ryvm_profile *profile) {
+  int64_t result = -1;
 
   while(vm->is_running) {
     //struct ryvm_ins ins = vm->instructions[ryvm_vm_pc(vm)];
 
     uint8_t *ins = (uint8_t*) ryvm_vm_pc(vm);
 
+    if(profile != NULL) {
+      //the PC is not guaranteed to be inside the text section
+      uint64_t offset = (uint64_t) ins - (uint64_t) (vm->data_and_code + vm->text_section_start);
+      if(offset < profile->text_size) {
+        profile->counts[offset]++;
+      }
+    }
+
     ryvm_vm_pc_inc(vm); //increment PC.
 
 
@@ -322,61 +1005,10 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
 
     switch(op) {
       /* Conversions */
-      case RYVM_OP_FPFX: {
-        //TODO, add algorithm to convert floating point to fixed point number
-        uint8_t is_signed = ins[3] & 128; // extract most significant bit
-        //uint8_t fixed_point_frac_precision = ins[3] & 127; //extract 7 least significant bits
-
-        if(reg2_bytewidth <= 4) {
-          float *old_value = (float*) vm->gen_registers + reg2_num;
-          if(is_signed) {
-            int64_t converted_value = (int64_t) *old_value;
-            memcpy(&vm->gen_registers[reg1_num], &converted_value, reg1_bytewidth);
-          } else {
-            uint64_t converted_value = (uint64_t) *old_value;
-            memcpy(&vm->gen_registers[reg1_num], &converted_value, reg1_bytewidth);
-          }
-        } else {
-          double *old_value = (double*) vm->gen_registers + reg2_num;
-          if(is_signed) {
-            int64_t converted_value = (int64_t) *old_value;
-            memcpy(&vm->gen_registers[reg1_num], &converted_value, reg1_bytewidth);
-          } else {
-            uint64_t converted_value = (uint64_t) *old_value;
-            memcpy(&vm->gen_registers[reg1_num], &converted_value, reg1_bytewidth);
-          }
-        }
-
-        break;
-      }
-
-      case RYVM_OP_FXFP: {
-        //TODO, add algorithm to convert fixed point to floating point number
-        uint8_t is_signed = ins[3] & 128; // extract most significant bit
-        //uint8_t fixed_point_frac_precision = ins[3] & 127; //extract 7 least significant bits
-
-        if(reg2_bytewidth <= 4) {
-          if(is_signed) {
-            int64_t *signed_value = (int64_t*) vm->gen_registers[reg2_num];
-            float converted_value = (float) *signed_value;
-            memcpy(&vm->gen_registers[reg1_num], &converted_value, reg1_bytewidth);
-          } else {
-            float converted_value = (float) vm->gen_registers[reg2_num];
-            memcpy(&vm->gen_registers[reg1_num], &converted_value, reg1_bytewidth);
-          }
-        } else {
-          if(is_signed) {
-            int64_t *signed_value = (int64_t*) vm->gen_registers[reg2_num];
-            double converted_value = (double) *signed_value;
-            memcpy(&vm->gen_registers[reg1_num], &converted_value, reg1_bytewidth);
-          } else {
-            double converted_value = (double) vm->gen_registers[reg2_num];
-            memcpy(&vm->gen_registers[reg1_num], &converted_value, reg1_bytewidth);
-          }
-        }
-
-        break;
-      }
+      case RYVM_OP_FPFX: ryvm_vm_float_to_fixed(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, ins[3]); break;
+      case RYVM_OP_FXFP: ryvm_vm_fixed_to_float(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, ins[3]); break;
+      case RYVM_OP_FXMUL: ryvm_vm_fixed_mul_div(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, ins[3], 0); break;
+      case RYVM_OP_FXDIV: ryvm_vm_fixed_mul_div(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, ins[3], 1); break;
 
       /* move, load, and store */
       case RYVM_OP_PCR: {
@@ -417,6 +1049,25 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
         break;
       }
 
+      //wide immediates are stored in the extension words right after the instruction,
+      //so PC must skip over them.
+      case RYVM_OP_LDI32: {
+        int32_t imm;
+        memcpy(&imm, ins + RYVM_INS_SIZE, sizeof(imm));
+        int64_t val = imm;
+        memcpy(&vm->gen_registers[reg1_num], &val, reg1_bytewidth);
+        ryvm_vm_pc_set(vm, ryvm_vm_pc(vm) + sizeof(imm));
+        break;
+      }
+
+      case RYVM_OP_LDI64: {
+        uint64_t val;
+        memcpy(&val, ins + RYVM_INS_SIZE, sizeof(val));
+        memcpy(&vm->gen_registers[reg1_num], &val, reg1_bytewidth);
+        ryvm_vm_pc_set(vm, ryvm_vm_pc(vm) + sizeof(val));
+        break;
+      }
+
       //store value at a memory address
       case RYVM_OP_STR: {
         //remember that THIS WILL CAUSE UNDEFINED BEHAVIOR if the address
@@ -427,6 +1078,85 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
         break;
       }
 
+      //scaled index addressing. The index counts elements of W0's bytewidth instead of bytes.
+      case RYVM_OP_LDX:
+      case RYVM_OP_STX: {
+        int64_t index = ryvm_vm_helper_sign_extend_64((uint8_t*) &vm->gen_registers[reg3_num], reg3_bytewidth);
+        uint8_t *address = (uint8_t*) (vm->gen_registers[reg2_num] + (uint64_t) index * reg1_bytewidth);
+        if(op == RYVM_OP_LDX) {
+          memcpy(&vm->gen_registers[reg1_num], address, reg1_bytewidth);
+        } else {
+          memcpy(address, &vm->gen_registers[reg1_num], reg1_bytewidth);
+        }
+        break;
+      }
+
+      //post-increment and pre-increment addressing. The whole base register is updated,
+      //regardless of its bytewidth.
+      case RYVM_OP_LDPOST:
+      case RYVM_OP_STPOST:
+      case RYVM_OP_LDPRE:
+      case RYVM_OP_STPRE: {
+        int8_t offset = ins[3];
+        uint8_t is_pre = op == RYVM_OP_LDPRE || op == RYVM_OP_STPRE;
+        uint64_t base = vm->gen_registers[reg2_num];
+        uint64_t updated = base + offset;
+        uint8_t *address = (uint8_t*) (is_pre ? updated : base);
+
+        //if W0 and W1 are the same register, pre-increment loads overwrite the new base, and
+        //post-increment loads are overwritten by it.
+        if(is_pre) {
+          vm->gen_registers[reg2_num] = updated;
+        }
+        if(op == RYVM_OP_LDPOST || op == RYVM_OP_LDPRE) {
+          memcpy(&vm->gen_registers[reg1_num], address, reg1_bytewidth);
+        } else {
+          memcpy(address, &vm->gen_registers[reg1_num], reg1_bytewidth);
+        }
+        if(!is_pre) {
+          vm->gen_registers[reg2_num] = updated;
+        }
+        break;
+      }
+
+      //push and pop a range of registers. The stack grows upwards, so STM stores then increments
+      //the base register, and LDM decrements it then loads.
+      case RYVM_OP_STM:
+      case RYVM_OP_LDM: {
+        if(reg2_num < reg1_num) {
+          break; //empty range
+        }
+        uint64_t count = reg2_num - reg1_num + 1;
+        uint64_t size = count * reg1_bytewidth;
+
+        if(op == RYVM_OP_LDM) {
+          vm->gen_registers[reg3_num] -= size;
+        }
+        uint8_t *address = (uint8_t*) vm->gen_registers[reg3_num];
+
+        //whole registers are next to each other in memory, so they can be copied at once
+        if(reg1_bytewidth == 8) {
+          if(op == RYVM_OP_STM) {
+            memcpy(address, &vm->gen_registers[reg1_num], size);
+          } else {
+            memcpy(&vm->gen_registers[reg1_num], address, size);
+          }
+        } else {
+          for(uint64_t i = 0; i < count; i++) {
+            if(op == RYVM_OP_STM) {
+              memcpy(address + i * reg1_bytewidth, &vm->gen_registers[reg1_num + i], reg1_bytewidth);
+            } else {
+              memcpy(&vm->gen_registers[reg1_num + i], address + i * reg1_bytewidth, reg1_bytewidth);
+            }
+          }
+        }
+
+        if(op == RYVM_OP_STM) {
+          vm->gen_registers[reg3_num] += size;
+        }
+        break;
+      }
+
       /* Bitwise operations */
       case RYVM_OP_AND: ryvm_vm_unsigned_int_arith(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, RYVM_VM_ARITH_OP_AND); break;
       case RYVM_OP_OR: ryvm_vm_unsigned_int_arith(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, RYVM_VM_ARITH_OP_OR); break;
@@ -477,6 +1207,29 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
       }
 
 
+      case RYVM_OP_ADDI32:
+      case RYVM_OP_SUBI32:
+      case RYVM_OP_ANDI32:
+      case RYVM_OP_ORI32:
+      case RYVM_OP_XORI32: {
+        int32_t imm32;
+        memcpy(&imm32, ins + RYVM_INS_SIZE, sizeof(imm32));
+        ryvm_vm_pc_set(vm, ryvm_vm_pc(vm) + sizeof(imm32));
+
+        uint64_t imm = (uint64_t) (int64_t) imm32; //sign extend
+        uint64_t a = vm->gen_registers[reg2_num];
+        uint64_t result;
+        switch(op) {
+          case RYVM_OP_ADDI32: result = a + imm; break;
+          case RYVM_OP_SUBI32: result = a - imm; break;
+          case RYVM_OP_ANDI32: result = a & imm; break;
+          case RYVM_OP_ORI32: result = a | imm; break;
+          default: result = a ^ imm; break;
+        }
+        memcpy(&vm->gen_registers[reg1_num], &result, reg1_bytewidth);
+        break;
+      }
+
       //note to use unsigned arithmetic for addition and subtraction
       //since 2's complement makes these operations identical regardless of sign or unsigned
       case RYVM_OP_ADD: ryvm_vm_unsigned_int_arith(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, RYVM_VM_ARITH_OP_ADD); break;
@@ -488,6 +1241,49 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
       case RYVM_OP_DIVU: ryvm_vm_unsigned_int_arith(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, RYVM_VM_ARITH_OP_DIV); break;
       case RYVM_OP_REM: ryvm_vm_signed_int_arith(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, RYVM_VM_ARITH_OP_REM); break;
       case RYVM_OP_REMU: ryvm_vm_unsigned_int_arith(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, RYVM_VM_ARITH_OP_REM); break;
+      case RYVM_OP_MULH: ryvm_vm_mul_high(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, 1); break;
+      case RYVM_OP_MULHU: ryvm_vm_mul_high(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, 0); break;
+
+      /* Bit manipulation */
+      case RYVM_OP_POPCNT:
+      case RYVM_OP_CLZ:
+      case RYVM_OP_CTZ: {
+        uint64_t val = 0;
+        memcpy(&val, &vm->gen_registers[reg2_num], reg2_bytewidth);
+        uint64_t bits = reg2_bytewidth * 8;
+        if(op == RYVM_OP_POPCNT) {
+          val = ryvm_vm_helper_popcount_64(val);
+        } else if(val == 0) {
+          val = bits;
+        } else if(op == RYVM_OP_CLZ) {
+          val = ryvm_vm_helper_clz_64(val) - (64 - bits);
+        } else {
+          val = ryvm_vm_helper_ctz_64(val);
+        }
+        memcpy(&vm->gen_registers[reg1_num], &val, reg1_bytewidth);
+        break;
+      }
+      case RYVM_OP_ROL:
+      case RYVM_OP_ROR: {
+        uint64_t val = 0;
+        memcpy(&val, &vm->gen_registers[reg2_num], reg2_bytewidth);
+        uint64_t bits = reg1_bytewidth * 8;
+        uint64_t amount = vm->gen_registers[reg3_num] % bits;
+        if(op == RYVM_OP_ROR) {
+          amount = (bits - amount) % bits;
+        }
+        //the bits shifted past the bytewidth of W0 are cut off by the memcpy
+        if(amount != 0) {
+          val = (val << amount) | ((val & (UINT64_MAX >> (64 - bits))) >> (bits - amount));
+        }
+        memcpy(&vm->gen_registers[reg1_num], &val, reg1_bytewidth);
+        break;
+      }
+      case RYVM_OP_BSWAP: {
+        uint64_t val = ryvm_vm_helper_bswap_64(vm->gen_registers[reg2_num]) >> (64 - reg1_bytewidth * 8);
+        memcpy(&vm->gen_registers[reg1_num], &val, reg1_bytewidth);
+        break;
+      }
 
 
       /* Arithmetic For 32-bit and 64-bit floating point numbers */
@@ -496,6 +1292,28 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
       case RYVM_OP_MULF: ryvm_vm_float_arith(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, RYVM_VM_ARITH_OP_MUL); break;
       case RYVM_OP_DIVF: ryvm_vm_float_arith(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, RYVM_VM_ARITH_OP_DIV); break;
       case RYVM_OP_REMF: ryvm_vm_float_arith(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, RYVM_VM_ARITH_OP_REM); break;
+      case RYVM_OP_FMA:
+      case RYVM_OP_FSQRT:
+      case RYVM_OP_FMIN:
+      case RYVM_OP_FMAX:
+      case RYVM_OP_FABS:
+      case RYVM_OP_FNEG:
+      case RYVM_OP_FRND:
+        ryvm_vm_float_math(vm, op, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, reg3_num, reg3_bytewidth, ins[3]);
+        break;
+      case RYVM_OP_FCVT: {
+        //bfloat16 is only used when asked for, since Q registers hold f16 by default
+        double value = (ins[3] & 2) && reg2_bytewidth == 2
+          ? ryvm_minifloat_bf16_to_f32((uint16_t) vm->gen_registers[reg2_num])
+          : ryvm_vm_helper_reg_to_double(vm->gen_registers[reg2_num], reg2_bytewidth);
+        if((ins[3] & 1) && reg1_bytewidth == 2) {
+          uint16_t bits = ryvm_minifloat_f32_to_bf16((float) value);
+          memcpy(&vm->gen_registers[reg1_num], &bits, 2);
+        } else {
+          ryvm_vm_store_float(vm, reg1_num, reg1_bytewidth, value);
+        }
+        break;
+      }
 
       /* Comparisons for signed/unsigned integers and floating point numbers */
 
@@ -571,33 +1389,13 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
 
         uint8_t overflowed = 0;
 
-        //copy register values, and manually zero extend them by clearing most significant bytes
-        uint8_t *s1 = (uint8_t*) (vm->gen_registers + reg2_num);
-        uint8_t *s2 = (uint8_t*) (vm->gen_registers + reg3_num);
-
         uint8_t largest_bytewidth = reg2_bytewidth > reg3_bytewidth ? reg2_bytewidth : reg3_bytewidth;
 
         //we need to ensure that both values are doubles
         if(largest_bytewidth > 4) { 
-          double a = 0; //zero out
-          double b = 0;
-          
-          //if either value is a float, convert it to double.
-          if(reg2_bytewidth <= 4) {
-            float af;
-            memcpy(&af, s1, 4);
-            a = (double) af;
-          } else {
-            memcpy(&a, s1, 8);
-          } 
-          
-          if(reg3_bytewidth <= 4) {
-            float bf;
-            memcpy(&bf, s2, 4);
-            b = (double) bf;
-          } else {
-            memcpy(&b, s2, 8);
-          }
+          //if either value is a smaller float, convert it to double.
+          double a = ryvm_vm_helper_reg_to_double(vm->gen_registers[reg2_num], reg2_bytewidth);
+          double b = ryvm_vm_helper_reg_to_double(vm->gen_registers[reg3_num], reg3_bytewidth);
 
           //clear exceptions since exceptions may persist across multiple floating point calculations
           feclearexcept(FE_OVERFLOW | FE_UNDERFLOW);
@@ -613,13 +1411,10 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
           //insert result in register
           memcpy(vm->gen_registers+reg1_num, &res, reg1_bytewidth);
         } 
-        //TODO:If the register width is smaller than 32 bits for floating point operations, we should throw a semantic error
-        //for now, we will just assume the bytewidth is 32 bits
+        //f16 and FP8 registers are compared as 32-bit floats
         else {
-          float a;
-          float b;
-          memcpy(&a, s1, 4);
-          memcpy(&b, s2, 4);
+          float a = ryvm_vm_helper_reg_to_float(vm->gen_registers[reg2_num], reg2_bytewidth);
+          float b = ryvm_vm_helper_reg_to_float(vm->gen_registers[reg3_num], reg3_bytewidth);
 
           feclearexcept(FE_OVERFLOW | FE_UNDERFLOW);
           float res = a - b;
@@ -632,7 +1427,7 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
           ryvm_vm_flags_set_flag(vm, (res == 0.0) | (res == -0.0) , RYVM_VM_STATUS_FLAG_Z);
 
           //insert result in register
-          memcpy(vm->gen_registers+reg1_num, &res, reg1_bytewidth);
+          ryvm_vm_store_float(vm, reg1_num, reg1_bytewidth, res);
 
         }
 
@@ -812,6 +1607,60 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
         break;
       }
 
+      case RYVM_OP_LOOP: {
+        //decrement the counter and branch back in one dispatch, replacing SUBI + CPSI + BNE
+        uint64_t value = 0;
+        memcpy(&value, &vm->gen_registers[reg1_num], reg1_bytewidth);
+        value--;
+        memcpy(&vm->gen_registers[reg1_num], &value, reg1_bytewidth);
+
+        //value was zero extended, so only the bytewidth of the register is tested
+        if(value == 0) {
+          break;
+        }
+
+        int16_t offset;
+        memcpy(&offset, ins + 2, sizeof(offset));
+        ryvm_vm_pc_set(vm, ryvm_vm_pc(vm) + offset);
+        break;
+      }
+
+      case RYVM_OP_CSEL:
+      case RYVM_OP_CSINC: {
+        ryvm_vm_conditional_select(vm, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth, ins[3], op == RYVM_OP_CSINC);
+        break;
+      }
+
+      case RYVM_OP_CBZ:
+      case RYVM_OP_CBNZ: {
+        //test the register directly instead of going through the SF register
+        uint64_t value = 0;
+        memcpy(&value, &vm->gen_registers[reg1_num], reg1_bytewidth);
+        if((value == 0) != (op == RYVM_OP_CBZ)) {
+          break;
+        }
+
+        int16_t offset;
+        memcpy(&offset, ins + 2, sizeof(offset));
+        ryvm_vm_pc_set(vm, ryvm_vm_pc(vm) + offset);
+        break;
+      }
+
+      case RYVM_OP_CBEQ:
+      case RYVM_OP_CBNE:
+      case RYVM_OP_CBLT:
+      case RYVM_OP_CBGE:
+      case RYVM_OP_CBLTU:
+      case RYVM_OP_CBGEU: {
+        if(!ryvm_vm_compare_branch_taken(vm, op, reg1_num, reg1_bytewidth, reg2_num, reg2_bytewidth)) {
+          break;
+        }
+
+        int8_t offset = (int8_t) ins[3];
+        ryvm_vm_pc_set(vm, ryvm_vm_pc(vm) + offset);
+        break;
+      }
+
       case RYVM_OP_BL: {
         //set LR to PC of next instruction
         vm->gen_registers[reg1_num] = ryvm_vm_pc(vm);
@@ -856,6 +1705,48 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
         break;
       }
 
+      //register window calls. The frame is pushed as 2 blocks, since W20-W39 and LR/FP are each next to each other.
+      case RYVM_OP_CALLW: {
+        int16_t offset;
+        memcpy(&offset, ins + 2, 2);
+
+        uint8_t *frame = (uint8_t*) ryvm_vm_stack_ptr(vm);
+        memcpy(frame, &vm->gen_registers[RYVM_CALLEE_SAVED_FIRST], RYVM_CALLEE_SAVED_COUNT * 8);
+        memcpy(frame + RYVM_CALLEE_SAVED_COUNT * 8, &vm->gen_registers[RYVM_LR_REG], 2 * 8);
+
+        uint64_t new_sp = (uint64_t) (frame + RYVM_CALL_FRAME_SIZE);
+        ryvm_vm_stack_ptr_set(vm, new_sp);
+        vm->gen_registers[RYVM_FP_REG] = new_sp;
+
+        vm->gen_registers[reg1_num] = ryvm_vm_pc(vm);
+        ryvm_vm_pc_set(vm, ryvm_vm_pc(vm) + offset);
+        break;
+      }
+
+      case RYVM_OP_RETW: {
+        int16_t offset;
+        memcpy(&offset, ins + 2, 2);
+
+        //read the target first, since W0 may be one of the registers being restored
+        uint64_t target = vm->gen_registers[reg1_num] + offset;
+
+        uint8_t *frame = (uint8_t*) vm->gen_registers[RYVM_FP_REG] - RYVM_CALL_FRAME_SIZE;
+        memcpy(&vm->gen_registers[RYVM_CALLEE_SAVED_FIRST], frame, RYVM_CALLEE_SAVED_COUNT * 8);
+        memcpy(&vm->gen_registers[RYVM_LR_REG], frame + RYVM_CALLEE_SAVED_COUNT * 8, 2 * 8);
+        ryvm_vm_stack_ptr_set(vm, (uint64_t) frame);
+
+        ryvm_vm_pc_set(vm, target);
+        break;
+      }
+
+      //reuses the frame of the current subroutine, so tail recursion runs in constant stack space
+      case RYVM_OP_TCALLW: {
+        int32_t offset = ryvm_vm_helper_cast_int_24_to_32(ins+1);
+        ryvm_vm_stack_ptr_set(vm, ryvm_vm_frame_ptr(vm));
+        ryvm_vm_pc_set(vm, ryvm_vm_pc(vm) + offset);
+        break;
+      }
+
 
       /* Misc */
 
@@ -879,21 +1770,143 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
             break;
           //print single register from W1
           case 1: 
+            ryvm_output_flush(&vm->output);
             printf("%lld\n", vm->gen_registers[1]);
             break;
           case 2: {
+            ryvm_output_flush(&vm->output);
             double *f = (double*) &vm->gen_registers[1];
             printf("%lf\n", *f);
             break;
           }
           case 3:
+            ryvm_output_flush(&vm->output);
             printf("%s\n", (char*) vm->gen_registers[1]);
             break;
           case 4: {
+            ryvm_output_flush(&vm->output);
             float *f = (float*) &vm->gen_registers[1];
             printf("%f\n", *f);
             break;
           }
+          case 5:
+            ryvm_vm_sys_map_file(vm);
+            break;
+          case 6:
+            ryvm_vm_sys_unmap_file(vm);
+            break;
+          //buffered output
+          case 7:
+            ryvm_output_write(&vm->output, (const void*) vm->gen_registers[1], vm->gen_registers[2]);
+            break;
+          case 8:
+            ryvm_output_write_u64(&vm->output, vm->gen_registers[1]);
+            break;
+          case 9:
+            ryvm_output_write_i64(&vm->output, (int64_t) vm->gen_registers[1]);
+            break;
+          case 10: {
+            char c = (char) vm->gen_registers[1];
+            ryvm_output_write(&vm->output, &c, 1);
+            break;
+          }
+          case 11:
+            ryvm_output_flush(&vm->output);
+            break;
+          case 12: {
+            double f;
+            memcpy(&f, &vm->gen_registers[1], 8);
+            ryvm_output_write_f64(&vm->output, f);
+            break;
+          }
+          //async I/O
+          case 13:
+            ryvm_vm_sys_aio_setup(vm);
+            break;
+          case 14:
+            vm->gen_registers[0] = vm->aio != NULL ? ryvm_aio_submit(vm->aio) : 0;
+            break;
+          case 15:
+            vm->gen_registers[0] = vm->aio != NULL ? ryvm_aio_reap(vm->aio, vm->gen_registers[1]) : 0;
+            break;
+          //fibers
+          case 16:
+            ryvm_vm_sys_fiber_create(vm);
+            break;
+          case 17:
+            ryvm_fiber_yield(vm);
+            break;
+          case 18: {
+            //set W1 first, since a successful join can switch to another fiber
+            uint64_t id = vm->gen_registers[1];
+            vm->gen_registers[1] = 0;
+            enum ryvm_fiber_status status = ryvm_fiber_join(vm, id);
+            if(status == RYVM_FIBER_STATUS_INVALID) {
+              vm->gen_registers[1] = 1;
+            } else if(status == RYVM_FIBER_STATUS_DEADLOCK) {
+              goto fiber_deadlock;
+            }
+            break;
+          }
+          case 19:
+            if(ryvm_fiber_exit(vm, vm->gen_registers[0]) != RYVM_FIBER_STATUS_OK) {
+              goto fiber_deadlock;
+            }
+            break;
+          //threads
+          case 20:
+            ryvm_vm_sys_thread_spawn(vm);
+            break;
+          case 21:
+            ryvm_vm_sys_thread_join(vm);
+            break;
+          //channels
+          case 22:
+            ryvm_vm_sys_channel_send(vm);
+            break;
+          case 23:
+            ryvm_vm_sys_channel_receive(vm);
+            break;
+          case 24: {
+            struct ryvm_channel *channel = ryvm_vm_get_channel(vm, vm->gen_registers[1]);
+            if(channel != NULL) {
+              ryvm_channel_close(channel);
+            }
+            vm->gen_registers[0] = channel == NULL;
+            break;
+          }
+          case 25:
+            ryvm_vm_sys_channel_create(vm);
+            break;
+          //bulk memory, using the C library since it is already vectorized for the host CPU
+          case 26:
+            memcpy((void*) vm->gen_registers[1], (const void*) vm->gen_registers[2], vm->gen_registers[3]);
+            break;
+          case 27:
+            memmove((void*) vm->gen_registers[1], (const void*) vm->gen_registers[2], vm->gen_registers[3]);
+            break;
+          case 28:
+            memset((void*) vm->gen_registers[1], (uint8_t) vm->gen_registers[2], vm->gen_registers[3]);
+            break;
+          case 29: {
+            int cmp = memcmp((const void*) vm->gen_registers[1], (const void*) vm->gen_registers[2], vm->gen_registers[3]);
+            vm->gen_registers[0] = (uint64_t) (int64_t) (cmp < 0 ? -1 : cmp > 0);
+            break;
+          }
+          case 30:
+            vm->gen_registers[0] = (uint64_t) memchr((const void*) vm->gen_registers[1], (uint8_t) vm->gen_registers[2], vm->gen_registers[3]);
+            break;
+          case 31:
+            vm->gen_registers[0] = strlen((const char*) vm->gen_registers[1]);
+            break;
+          //convert an array of floats between formats
+          case 32:
+            vm->gen_registers[0] = !ryvm_minifloat_convert_array(
+              (void*) vm->gen_registers[1], (enum ryvm_float_format) vm->gen_registers[2],
+              (const void*) vm->gen_registers[3], (enum ryvm_float_format) vm->gen_registers[4],
+              vm->gen_registers[5]
+            );
+            break;
           default:
             goto syscall_fail;
         }
@@ -905,8 +1918,93 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
           vm->is_running = 0;
           printf("ERROR: Invalid syscall value!\n");
           continue;
+        fiber_deadlock:
+          vm->is_running = 0;
+          printf("ERROR: No fibers are left to run!\n");
+          continue;
+
+      }
+
+      /* Atomic operations */
+      case RYVM_OP_CAS: {
+        void *address = (void*) vm->gen_registers[reg3_num];
+        uint64_t old = ryvm_atomic_cas(address, vm->gen_registers[reg1_num], vm->gen_registers[reg2_num], reg1_bytewidth);
+        memcpy(&vm->gen_registers[reg1_num], &old, reg1_bytewidth);
+        break;
+      }
+      case RYVM_OP_LDADD: {
+        void *address = (void*) vm->gen_registers[reg3_num];
+        uint64_t old = ryvm_atomic_fetch_add(address, vm->gen_registers[reg2_num], reg1_bytewidth);
+        memcpy(&vm->gen_registers[reg1_num], &old, reg1_bytewidth);
+        break;
+      }
+      case RYVM_OP_LDAR: {
+        int8_t offset = ins[3];
+        uint64_t value = ryvm_atomic_load_acquire((void*) (vm->gen_registers[reg2_num] + offset), reg1_bytewidth);
+        memcpy(&vm->gen_registers[reg1_num], &value, reg1_bytewidth);
+        break;
+      }
+      case RYVM_OP_STLR: {
+        int8_t offset = ins[3];
+        ryvm_atomic_store_release((void*) (vm->gen_registers[reg2_num] + offset), vm->gen_registers[reg1_num], reg1_bytewidth);
+        break;
+      }
+      case RYVM_OP_FENCE:
+        ryvm_atomic_fence();
+        break;
+
+      /* Vector operations */
+      //vector registers only go up to V31, so the upper bit of the register number is ignored
+      case RYVM_OP_VLD: {
+        int8_t offset = ins[3];
+        memcpy(vm->vec_registers[reg1_num % RYVM_VECTOR_NUM_REGISTERS], (void*) (vm->gen_registers[reg2_num] + offset), RYVM_VECTOR_BYTES);
+        break;
+      }
+      case RYVM_OP_VST: {
+        int8_t offset = ins[3];
+        memcpy((void*) (vm->gen_registers[reg2_num] + offset), vm->vec_registers[reg1_num % RYVM_VECTOR_NUM_REGISTERS], RYVM_VECTOR_BYTES);
+        break;
+      }
 
+      #define RYVM_VM_VECTOR_OP(table, index) \
+        vm->vector->table[index]( \
+          (uint8_t*) vm->vec_registers[reg1_num % RYVM_VECTOR_NUM_REGISTERS], \
+          (const uint8_t*) vm->vec_registers[reg2_num % RYVM_VECTOR_NUM_REGISTERS], \
+          (const uint8_t*) vm->vec_registers[reg3_num % RYVM_VECTOR_NUM_REGISTERS] \
+        )
+
+      case RYVM_OP_VADD: RYVM_VM_VECTOR_OP(add, ryvm_vector_lane_index(reg1_bytewidth)); break;
+      case RYVM_OP_VSUB: RYVM_VM_VECTOR_OP(sub, ryvm_vector_lane_index(reg1_bytewidth)); break;
+      case RYVM_OP_VMUL: RYVM_VM_VECTOR_OP(mul, ryvm_vector_lane_index(reg1_bytewidth)); break;
+      case RYVM_OP_VADDF: RYVM_VM_VECTOR_OP(addf, ryvm_vector_float_index(reg1_bytewidth)); break;
+      case RYVM_OP_VSUBF: RYVM_VM_VECTOR_OP(subf, ryvm_vector_float_index(reg1_bytewidth)); break;
+      case RYVM_OP_VMULF: RYVM_VM_VECTOR_OP(mulf, ryvm_vector_float_index(reg1_bytewidth)); break;
+      case RYVM_OP_VCMPEQ: RYVM_VM_VECTOR_OP(cmpeq, ryvm_vector_lane_index(reg1_bytewidth)); break;
+      case RYVM_OP_VCMPGT: RYVM_VM_VECTOR_OP(cmpgt, ryvm_vector_lane_index(reg1_bytewidth)); break;
+
+      #undef RYVM_VM_VECTOR_OP
+
+      case RYVM_OP_VRADD: {
+        uint64_t sum = ryvm_vector_reduce_add((const uint8_t*) vm->vec_registers[reg2_num % RYVM_VECTOR_NUM_REGISTERS], reg2_bytewidth);
+        memcpy(&vm->gen_registers[reg1_num], &sum, reg1_bytewidth);
+        break;
+      }
+      case RYVM_OP_VRADDF: {
+        //float sums are never converted, so they are always as wide as the lanes
+        uint8_t lane_bytewidth = ryvm_vector_float_index(reg2_bytewidth) == 1 ? 8 : 4;
+        uint64_t sum = ryvm_vector_reduce_addf((const uint8_t*) vm->vec_registers[reg2_num % RYVM_VECTOR_NUM_REGISTERS], lane_bytewidth);
+        memcpy(&vm->gen_registers[reg1_num], &sum, lane_bytewidth);
+        break;
       }
+      case RYVM_OP_VDUP:
+        ryvm_vector_dup((uint8_t*) vm->vec_registers[reg1_num % RYVM_VECTOR_NUM_REGISTERS], vm->gen_registers[reg2_num], reg1_bytewidth);
+        break;
+      case RYVM_OP_VMSK: {
+        uint64_t mask = ryvm_vector_mask((const uint8_t*) vm->vec_registers[reg2_num % RYVM_VECTOR_NUM_REGISTERS], reg2_bytewidth);
+        memcpy(&vm->gen_registers[reg1_num], &mask, reg1_bytewidth);
+        break;
+      }
+
       default:
         assert(0);
     }
@@ -914,13 +2012,56 @@ int64_t ryvm_vm_run(struct ryvm *vm) {
 
   }
 
+  return result;
+}
+
+int64_t ryvm_vm_execute(struct ryvm *vm) {
+  vm->is_running = 1;
+
+  int64_t result;
+  if(vm->profile != NULL) {
+    result = ryvm_vm_dispatch(vm, vm->profile);
+  } else {
+    result = ryvm_vm_dispatch(vm, NULL);
+  }
 
+  //whatever the program wrote must come out before the host prints anything else
+  ryvm_output_flush(&vm->output);
 
   return result;
 }
 
 
 void ryvm_vm_free(struct ryvm *vm) {
-  free(vm->stack);
-  free(vm->data_and_code);
+  //threads share our data and text sections and channels, so they must finish first
+  ryvm_thread_join_all(vm);
+
+  for(uint8_t i = 0; i < vm->num_channels; i++) {
+    if(vm->owned_channels & (1u << i)) {
+      ryvm_channel_free(vm->channels[i]);
+    }
+  }
+  vm->num_channels = 0;
+  vm->owned_channels = 0;
+
+  //workers may still be writing to guest memory
+  ryvm_aio_free(vm->aio);
+  vm->aio = NULL;
+
+  ryvm_fiber_free_all(vm);
+
+  for(uint8_t i = 0; i < vm->num_mapped_files; i++) {
+    ryvm_mapped_file_close(&vm->mapped_files[i]);
+  }
+  vm->num_mapped_files = 0;
+
+  ryvm_output_free(&vm->output);
+  ryvm_symbols_free(&vm->symbols);
+
+  ryvm_vm_free_region(vm, vm->stack, vm->stack_size);
+  if(vm->owns_data_and_code) {
+    ryvm_vm_free_region(vm, vm->data_and_code, vm->data_and_code_size);
+  }
+  vm->stack = NULL;
+  vm->data_and_code = NULL;
 }
@@ -8,6 +8,16 @@
 #include <stdio.h>
 
 #include "../opcodes.h"
+#include "mapped_file.h"
+#include "output.h"
+#include "aio.h"
+#include "fiber.h"
+#include "thread.h"
+#include "channel.h"
+#include "vector.h"
+#include "profile.h"
+#include "symbols.h"
+#include "../memory/array_builder.h"
 
 enum ryvm_num_type {
   RYVM_INT_TYPE_UINT8,
@@ -23,20 +33,94 @@ enum ryvm_num_type {
   RYVM_INT_TYPE_FLOAT64
 };
 
+//the max number of host memory regions that can be shared with a guest program
+#define RYVM_VM_MAX_HOST_REGIONS 8
+
+enum ryvm_host_region_access {
+  RYVM_HOST_REGION_READ = 1,
+  RYVM_HOST_REGION_WRITE = 2,
+};
+
+//a block of memory owned by the host program that the guest program can access directly.
+struct ryvm_host_region {
+  void *data;
+  uint64_t size;
+  uint32_t access; //bit flags from enum ryvm_host_region_access
+};
+
+//the max number of channels a VM can use
+#define RYVM_VM_MAX_CHANNELS 16
+
+//the max number of files a guest program can have mapped at once
+#define RYVM_VM_MAX_MAPPED_FILES 16
+
 struct ryvm {
   uint8_t *data_and_code;
   uint64_t data_and_code_size;
 
+  //0 if data_and_code points into an image owned by the host (see ryvm_vm_load_image)
+  uint8_t owns_data_and_code;
+
   uint64_t text_section_start;
 
-  //general registers
-  uint64_t gen_registers[64];
+  //general registers of the fiber that is running. Switching fibers only changes this pointer.
+  uint64_t *gen_registers;
+
+  //register file used until the first fiber is created
+  uint64_t main_registers[64];
 
+  //vector registers V0-V31, used by the V* instructions. Fibers share these, so a fiber
+  //cannot expect its vector registers to survive a yield.
+  uint64_t vec_registers[RYVM_VECTOR_NUM_REGISTERS][RYVM_VECTOR_BYTES / sizeof(uint64_t)];
 
+  //the SIMD implementation picked for this CPU when the VM was initialized
+  const struct ryvm_vector_impl *vector;
 
   uint8_t *stack;
   uint64_t stack_size;
 
+  //host memory shared with the guest. When the program starts, region i's address is
+  //stored in W(2i) and its size is stored in W(2i + 1).
+  struct ryvm_host_region host_regions[RYVM_VM_MAX_HOST_REGIONS];
+  uint8_t num_host_regions;
+
+  //files mapped by the guest using SYS 5. Any files still mapped are unmapped by ryvm_vm_free.
+  struct ryvm_mapped_file mapped_files[RYVM_VM_MAX_MAPPED_FILES];
+  uint8_t num_mapped_files;
+
+  //output written by SYS 7 to 12. Flushed when full, when the program ends, and before SYS 1 to 4 print anything.
+  struct ryvm_output output;
+
+  //async I/O ring set up by SYS 13, or NULL
+  struct ryvm_aio *aio;
+
+  //every fiber ever created, indexed by fiber id (struct ryvm_fiber). 
+  //Only initialized once current_fiber is not NULL.
+  struct memory_array_builder fibers;
+  struct ryvm_fiber *current_fiber;
+  struct ryvm_fiber *free_fibers;
+
+  //host threads spawned by SYS 20, indexed by thread id. NULL for unused ids.
+  struct ryvm_thread *threads[RYVM_VM_MAX_THREADS];
+
+  //channels the guest can use with SYS 22 to 25, indexed by channel id. Spawned threads inherit 
+  //the channels of their parent at the time they are spawned.
+  struct ryvm_channel *channels[RYVM_VM_MAX_CHANNELS];
+  uint8_t num_channels;
+
+  //bit i is set if channel i was created by the guest and must be freed along with the VM
+  uint16_t owned_channels;
+
+  //memory_page_flag bits used to allocate the data/text block and the stack.
+  //Set this before calling ryvm_vm_load. If zero, malloc is used instead.
+  uint32_t page_flags;
+
+  //execution counters for each instruction, or NULL. Set this before calling ryvm_vm_run (see profile.h).
+  struct ryvm_profile *profile;
+
+  //labels and source lines of the text section, read from images assembled with -g. Empty otherwise.
+  struct ryvm_symbols symbols;
+
   uint8_t is_running;
 
 };
@@ -47,6 +131,17 @@ enum ryvm_vm_status_flag {
   RYVM_VM_STATUS_FLAG_Z = 4,  //zero flag
 };
 
+//condition codes used by the immediate of CSEL and CSINC.
+//They test the SF register the same way BEQ, BNE, BLT, BGT, BLE, and BGE do.
+enum ryvm_vm_condition {
+  RYVM_VM_CONDITION_EQ = 0,
+  RYVM_VM_CONDITION_NE = 1,
+  RYVM_VM_CONDITION_LT = 2,
+  RYVM_VM_CONDITION_GT = 3,
+  RYVM_VM_CONDITION_LE = 4,
+  RYVM_VM_CONDITION_GE = 5,
+};
+
 //force these functions to be inline to minimize overhead during runtime.
 extern inline uint64_t ryvm_vm_stack_ptr(struct ryvm *vm);
 extern inline uint64_t ryvm_vm_frame_ptr(struct ryvm *vm);
@@ -67,8 +162,35 @@ extern inline void ryvm_vm_lr_set(struct ryvm *vm, uint64_t new_val);
 extern inline void ryvm_vm_byte_to_reg(uint8_t reg, uint8_t *reg_bytewidth, uint8_t *reg_num);
 
 
+//set the VM to its default configuration. Must be called before ryvm_vm_load.
+void ryvm_vm_init(struct ryvm *vm);
+
+//load a program from a .ryc file. Returns 0 if the file is not a valid image, after freeing 
+//anything the load allocated, so ryvm_vm_free does not need to be called.
 int ryvm_vm_load(struct ryvm *vm, FILE *input);
+
+//load a program from an executable image already in memory, such as one made by 
+//ryvm_assemble_buffer_to_image. The program runs directly from the image without being copied,
+//so the image must stay alive until ryvm_vm_free is called. Relocations are applied to the image itself, 
+//so an image can only be loaded once. The data/text block ignores page_flags, only the stack uses them.
+//Images with a compressed text section are the exception, they are expanded into a copy owned by the VM.
+int ryvm_vm_load_image(struct ryvm *vm, uint8_t *image, size_t image_size);
+
+//share a block of host memory with the guest without copying it. The host must keep the memory
+//alive until the VM finishes running. Since the VM does not check memory accesses,
+//the access flags only document how the guest is expected to use the region.
+//Returns the index of the region, or -1 if RYVM_VM_MAX_HOST_REGIONS regions were already added.
+int ryvm_vm_add_host_region(struct ryvm *vm, void *data, uint64_t size, uint32_t access);
+//let the guest use a channel owned by the host. The same channel can be added to several VMs, which
+//lets VMs running on different threads pass messages to each other. The host must keep the channel alive
+//until every VM using it is freed. Returns the id of the channel, or -1 if RYVM_VM_MAX_CHANNELS channels were already added.
+int ryvm_vm_add_channel(struct ryvm *vm, struct ryvm_channel *channel);
+
 int64_t ryvm_vm_run(struct ryvm *vm);
+
+//run instructions starting from the current state of the registers, without setting them up like ryvm_vm_run does.
+//Used to start spawned threads.
+int64_t ryvm_vm_execute(struct ryvm *vm);
 void ryvm_vm_free(struct ryvm *vm);
 
 
@@ -105,6 +105,7 @@ int main(int argc, const char **argv) {
     fseek(out, 0, SEEK_SET);
 
     struct ryvm vm;
+    ryvm_vm_init(&vm);
     printf("======= START PROGRAM FOR %s =======\n", argv[i]);
     ryvm_vm_load(&vm, out);
     printf("Program result: %lld\n", ryvm_vm_run(&vm));